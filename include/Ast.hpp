@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Tree.hpp"
+
+class Parser;
+class Scanner;
+struct DesignatorSite;
+
+// Проанализированная программа в виде дерева для генераторов кода.
+// Строится повторным проходом по токенам после Parser::analyse(): имена
+// уже разрешены анализом и берутся из designator'ов по позиции.
+
+// a, a.b.c, m(), a.b.m()
+struct AstDesignator {
+    enum Root : uint8_t { Local, Global, Field, Method };
+
+    Root root = Local;
+    std::vector<std::string> path;      // имена от корня, у вызова последнее - метод
+    const DesignatorSite* site = nullptr;
+    PrimitiveDataType type = UndefinedType;
+    bool call = false;
+
+    const std::string& fullName() const;                        // для печати присваивания
+    const std::string& declName() const { return path.back(); } // для сообщения о приведении
+};
+
+struct AstExpr {
+    enum Kind : uint8_t { Const, Var, Call, PreInc, PostInc, Neg, Binary };
+
+    Kind kind = Const;
+    PrimitiveDataType type = UndefinedType;
+    uint16_t op = 0;        // Binary - операция, PreInc/PostInc - TInc/TDec
+    TData value;            // Const
+    AstDesignator ref;      // Var, Call, PreInc, PostInc
+    std::unique_ptr<AstExpr> left, right;
+};
+
+struct AstStmt {
+    enum Kind : uint8_t { Block, Decl, ObjectDecl, Assign, Step, Call, While, Return };
+
+    Kind kind = Block;
+    std::string name;           // Decl, ObjectDecl
+    std::string className;      // ObjectDecl
+    PrimitiveDataType type = UndefinedType;     // Decl
+    uint16_t op = 0;            // Assign - TEval или операция составного, Step - TInc/TDec
+    AstDesignator target;       // Assign, Step, Call
+    std::unique_ptr<AstExpr> expr;  // инициализатор, правая часть, условие, результат return
+    std::vector<AstStmt> body;      // Block, While
+};
+
+// поле, глобальная переменная: число или объект класса className
+struct AstVar {
+    std::string name;
+    PrimitiveDataType type = UndefinedType;
+    std::string className;
+};
+
+struct AstMethod {
+    std::string name;
+    PrimitiveDataType type = UndefinedType;     // UndefinedType - метод объектного типа
+    std::vector<AstStmt> body;
+};
+
+struct AstClass {
+    std::string name;
+    std::vector<AstVar> fields;
+    std::vector<AstMethod> methods;
+};
+
+struct AstProgram {
+    std::vector<AstClass> classes;
+    std::vector<AstVar> globals;    // константы подставлены в выражения
+    std::vector<AstStmt> main;
+    bool quiet = false;             // без печати присваиваний (--quiet)
+};
+
+// Конструкции, которые генераторы не поддерживают (объект в выражении),
+// дают std::runtime_error.
+AstProgram buildAst(Scanner& scanner, const Parser& parser);
+
+// Удаляет операторы после return, циклы с ложным константным условием и
+// методы, не вызываемые из main. При quiet ещё и записи в локальные
+// переменные, которые не читаются, если запись ничего не печатает.
+void eliminateDeadCode(AstProgram& program);
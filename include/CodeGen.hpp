@@ -0,0 +1,16 @@
+#pragma once
+
+#include <ostream>
+
+#include "Ast.hpp"
+
+// Генераторы кода по дереву программы. Вывод собранной программы
+// совпадает с выполнением в интерпретаторе без отладочных строк: печать
+// присваиваний, сообщения о приведении типов, предупреждения в std::cerr.
+
+// Самостоятельный исходник C++: класс - struct с полями, метод - функция-член.
+void emitCpp(const AstProgram& program, std::ostream& out);
+
+// Исходник GNU as для x86-64 (System V, Linux): собирается as и ld без
+// библиотеки C, печать и системные вызовы - в собственной поддержке.
+void emitAsm(const AstProgram& program, std::ostream& out);
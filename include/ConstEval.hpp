@@ -0,0 +1,1012 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "Expr.hpp"
+#include "Scanner.hpp"
+
+// Выполнение программы во время компиляции C++. evaluateProgram разбирает
+// исходник из string_view тем же scanLexeme, что и Scanner, выполняет его
+// с арифметикой Expr.hpp и возвращает итоговые значения глобальных
+// переменных и числовых переменных верхнего уровня main:
+//
+//     constexpr ConstValues v = evaluateProgram("int main() { int n = 6 * 7; }");
+//     static_assert(v.getInt("n") == 42);
+//
+// Результат совпадает с интерпретатором (сверка - tools/ConstEvalCheck.cpp,
+// компилируется вместе с проектом); печати присваиваний нет, а
+// предупреждения при компиляции не выводятся. Ошибка
+// разбора или семантики - исключение, а в constexpr-вызове - ошибка
+// компиляции. Длинные циклы ограничены -fconstexpr-loop-limit и
+// -fconstexpr-ops-limit компилятора.
+
+struct ConstValue {
+    std::string_view name;      // указывает в исходник программы
+    PrimitiveDataType type = UndefinedType;
+    TData value;
+};
+
+struct ConstValues {
+    static constexpr size_t Capacity = 256;
+
+    std::array<ConstValue, Capacity> values{};
+    size_t count = 0;
+
+    // переменная main заслоняет глобальную с тем же именем
+    constexpr const ConstValue* find(std::string_view name) const {
+        for (size_t i = count; i-- > 0;) {
+            if (values[i].name == name) return &values[i];
+        }
+        return nullptr;
+    }
+    constexpr const ConstValue& at(std::string_view name) const {
+        const ConstValue* v = find(name);
+        if (!v) throw std::out_of_range("нет переменной с таким именем");
+        return *v;
+    }
+    constexpr int getInt(std::string_view name) const { return at(name).value.asInt(); }
+    constexpr double getDouble(std::string_view name) const { return at(name).value.asDouble(); }
+};
+
+// Разбор строит компактное дерево с уже разрешёнными именами: переменная -
+// ячейка глобальной памяти, кадра или объекта this. Кадр метода выделяется
+// при вызове, объект занимает подряд ячейки своих полей, как в Parser.
+class ConstEvaluator {
+public:
+    constexpr explicit ConstEvaluator(std::string_view source) : source(source) {}
+
+    constexpr ConstValues run() {
+        tokenize();
+        program();
+        execute();
+
+        ConstValues result;
+        for (const Report& r : reports) {
+            if (result.count == ConstValues::Capacity) {
+                fail("вычисление при компиляции: слишком много переменных");
+            }
+            result.values[result.count++] =
+                ConstValue{r.name, r.type, memory[(r.base == Global ? 0 : mainFp) + r.offset]};
+        }
+        return result;
+    }
+
+private:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    enum Base : uint8_t { Global, Local, This };
+
+    struct Token {
+        uint16_t code = TEnd;
+        std::string_view text;
+    };
+
+    // разрешённый designator: ячейка base + offset или вызов метода у
+    // объекта по этому адресу
+    struct Ref {
+        Base base = Global;
+        uint32_t offset = 0;
+        PrimitiveDataType type = UndefinedType;
+        uint32_t cls = None;        // класс объекта
+        uint32_t method = None;
+        bool constant = false;
+    };
+
+    struct Symbol {
+        std::string_view name;
+        Ref ref;
+    };
+
+    struct Member {
+        std::string_view name;
+        uint32_t offset = 0;
+        PrimitiveDataType type = UndefinedType;
+        uint32_t cls = None;
+        uint32_t method = None;
+    };
+
+    struct Class {
+        std::string_view name;
+        std::vector<Member> members;
+        std::vector<TData> proto;   // начальные значения полей
+    };
+
+    struct Method {
+        PrimitiveDataType type = UndefinedType;
+        uint32_t body = None;
+        uint32_t frame = 0;
+    };
+
+    struct Expr {
+        enum Kind : uint8_t { Const, Var, Call, PreInc, PostInc, Neg, Binary };
+
+        Kind kind = Const;
+        PrimitiveDataType type = UndefinedType;
+        uint16_t op = 0;
+        TData value;
+        Ref ref;
+        uint32_t left = None, right = None;
+    };
+
+    struct Stmt {
+        enum Kind : uint8_t { Block, Decl, ObjectDecl, Assign, Step, Call, While, Return };
+
+        Kind kind = Block;
+        PrimitiveDataType type = UndefinedType;
+        uint16_t op = 0;
+        Ref target;                 // Assign, Step, Call; у Decl/ObjectDecl - ячейка
+        uint32_t cls = None;        // ObjectDecl
+        uint32_t expr = None;
+        uint32_t first = 0, count = 0;  // Block, While: тело в children
+    };
+
+    struct Report {
+        std::string_view name;
+        PrimitiveDataType type;
+        Base base;
+        uint32_t offset;
+    };
+
+    std::string_view source;
+    std::vector<Token> tokens;
+    uint32_t cur = 0;
+
+    std::vector<Class> classes;
+    std::vector<Method> methods;
+    std::vector<Expr> exprs;
+    std::vector<Stmt> stmts;
+    std::vector<uint32_t> children;
+
+    std::vector<Symbol> globals;
+    std::vector<TData> globalInit;
+    std::vector<Symbol> locals;
+    std::vector<size_t> scopes;     // начало области в locals
+    std::vector<Report> reports;
+    uint32_t currentClass = None;
+    uint32_t frameSize = 0;
+    bool inMain = false;
+    uint32_t mainBody = None;
+    uint32_t mainFrame = 0;
+
+    std::vector<TData> memory;
+    uint32_t mainFp = 0;
+    uint32_t fp = 0;
+    uint32_t self = 0;
+    TData result;
+    bool returning = false;
+
+    // не constexpr: при вычислении во время компиляции её вызов - ошибка
+    // компиляции с текстом сообщения в диагностике
+    [[noreturn]] static void fail(const char* message) {
+        throw std::runtime_error(message);
+    }
+
+    static constexpr TData zero(PrimitiveDataType t) {
+        return t == DoubleType ? TData::Double(0.0) : TData::Int(0);
+    }
+
+    // ---- токены ----
+
+    constexpr void tokenize() {
+        uint32_t pos = 0;
+        uint32_t line = 1;
+        while (true) {
+            const Lexeme lx = scanLexeme(source, pos, line);
+            if (lx.code == Terr) fail(lx.error);
+            tokens.push_back(Token{lx.code, source.substr(lx.start, lx.length)});
+            if (lx.code == TEnd) return;
+        }
+    }
+
+    constexpr uint16_t code(uint32_t ahead = 0) const {
+        const uint32_t i = cur + ahead;
+        return i < tokens.size() ? tokens[i].code : static_cast<uint16_t>(TEnd);
+    }
+    constexpr std::string_view text() const { return tokens[cur].text; }
+    constexpr void next() {
+        if (cur + 1 < tokens.size()) cur++;
+    }
+    constexpr void expect(uint16_t c) {
+        if (code() != c) fail("вычисление при компиляции: неожиданный токен");
+        next();
+    }
+    constexpr std::string_view expectId() {
+        const std::string_view name = text();
+        expect(TId);
+        return name;
+    }
+
+    // ---- константы ----
+
+    using Big = std::vector<uint32_t>;
+
+    static constexpr uint32_t bigBits(const Big& v) {
+        for (size_t i = v.size(); i-- > 0;) {
+            if (v[i]) return static_cast<uint32_t>(32 * i + std::bit_width(v[i]));
+        }
+        return 0;
+    }
+    static constexpr void bigMulAdd(Big& v, uint32_t mul, uint32_t add) {
+        uint64_t carry = add;
+        for (uint32_t& limb : v) {
+            const uint64_t x = static_cast<uint64_t>(limb) * mul + carry;
+            limb = static_cast<uint32_t>(x);
+            carry = x >> 32;
+        }
+        if (carry) v.push_back(static_cast<uint32_t>(carry));
+    }
+    static constexpr void bigShl(Big& v, uint32_t bits) {
+        v.insert(v.begin(), bits / 32, 0u);
+        bits %= 32;
+        if (!bits) return;
+        uint32_t carry = 0;
+        for (uint32_t& limb : v) {
+            const uint32_t next = limb >> (32 - bits);
+            limb = (limb << bits) | carry;
+            carry = next;
+        }
+        if (carry) v.push_back(carry);
+    }
+    static constexpr void bigShr1(Big& v) {
+        for (size_t i = 0; i < v.size(); ++i) {
+            v[i] = (v[i] >> 1) | (i + 1 < v.size() ? v[i + 1] << 31 : 0u);
+        }
+    }
+    static constexpr int bigCmp(const Big& a, const Big& b) {
+        for (size_t i = std::max(a.size(), b.size()); i-- > 0;) {
+            const uint32_t x = i < a.size() ? a[i] : 0;
+            const uint32_t y = i < b.size() ? b[i] : 0;
+            if (x != y) return x < y ? -1 : 1;
+        }
+        return 0;
+    }
+    // a -= b, a >= b
+    static constexpr void bigSub(Big& a, const Big& b) {
+        int64_t borrow = 0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            int64_t x = static_cast<int64_t>(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+            borrow = x < 0;
+            a[i] = static_cast<uint32_t>(x + (borrow << 32));
+        }
+    }
+
+    static constexpr TData intConst(std::string_view digits) {
+        int64_t v = 0;
+        for (char ch : digits) {
+            v = v * 10 + (ch - '0');
+            if (v > INT32_MAX) fail("вычисление при компиляции: константа вне диапазона int");
+        }
+        return TData::Int(static_cast<int>(v));
+    }
+
+    // Ближайший double к digits (вида 123.456), как std::stod: N / 10^f
+    // делится точно, частное из 54-55 бит округляется к чётному.
+    static constexpr TData doubleConst(std::string_view digits) {
+        Big num{0}, den{1};
+        uint32_t fraction = 0;
+        bool afterPoint = false;
+        for (char ch : digits) {
+            if (ch == '.') {
+                afterPoint = true;
+                continue;
+            }
+            bigMulAdd(num, 10, static_cast<uint32_t>(ch - '0'));
+            if (afterPoint) {
+                bigMulAdd(den, 10, 0);
+                fraction++;
+            }
+        }
+        if (bigBits(num) == 0) return TData::Double(0.0);
+
+        const int shift = 54 - (static_cast<int>(bigBits(num)) - static_cast<int>(bigBits(den)));
+        if (shift > 0) bigShl(num, static_cast<uint32_t>(shift));
+        else bigShl(den, static_cast<uint32_t>(-shift));
+
+        uint64_t q = 0;
+        bigShl(den, 55);
+        for (int bit = 55; bit >= 0; --bit) {
+            if (bigCmp(num, den) >= 0) {
+                bigSub(num, den);
+                q |= uint64_t{1} << bit;
+            }
+            bigShr1(den);
+        }
+        const bool rest = bigBits(num) != 0;
+
+        int extra = std::bit_width(q) - 53;
+        uint64_t mant = q >> extra;
+        const uint64_t dropped = q & ((uint64_t{1} << extra) - 1);
+        const uint64_t half = uint64_t{1} << (extra - 1);
+        if (dropped > half || (dropped == half && (rest || (mant & 1)))) {
+            if (++mant == (uint64_t{1} << 53)) {
+                mant >>= 1;
+                extra++;
+            }
+        }
+
+        const int exponent = extra - shift + 52;
+        if (exponent > 1023 || exponent < -1022) {
+            fail("вычисление при компиляции: константа вне диапазона double");
+        }
+        const uint64_t bits = (static_cast<uint64_t>(exponent + 1023) << 52) | (mant & ((uint64_t{1} << 52) - 1));
+        return TData::Double(std::bit_cast<double>(bits));
+    }
+
+    // ---- имена ----
+
+    constexpr void beginScope() { scopes.push_back(locals.size()); }
+    constexpr void endScope() {
+        locals.resize(scopes.back());
+        scopes.pop_back();
+    }
+
+    constexpr uint32_t findClass(std::string_view name) const {
+        for (uint32_t i = 0; i < classes.size(); ++i) {
+            if (classes[i].name == name) return i;
+        }
+        return None;
+    }
+
+    constexpr const Member* findMember(uint32_t cls, std::string_view name) const {
+        for (const Member& m : classes[cls].members) {
+            if (m.name == name) return &m;
+        }
+        return nullptr;
+    }
+
+    // дублирование проверяется только в текущей области, как checkDuplicateId
+    constexpr void checkDuplicate(std::string_view name) const {
+        bool duplicate = false;
+        if (!scopes.empty()) {
+            for (size_t i = scopes.back(); i < locals.size(); ++i) {
+                duplicate = duplicate || locals[i].name == name;
+            }
+        } else if (currentClass != None) {
+            duplicate = findMember(currentClass, name) != nullptr;
+        } else {
+            duplicate = findClass(name) != None;
+            for (const Symbol& g : globals) {
+                duplicate = duplicate || g.name == name;
+            }
+        }
+        if (duplicate) fail("Семантическая ошибка: дублирование идентификатора");
+    }
+
+    constexpr uint32_t objectClass(std::string_view typeName) const {
+        const uint32_t cls = findClass(typeName);
+        if (cls == None) fail("Семантическая ошибка: тип не найден как класс");
+        return cls;
+    }
+
+    constexpr uint32_t objectSize(uint32_t cls) const {
+        return static_cast<uint32_t>(classes[cls].proto.size());
+    }
+
+    // локальная переменная: ячейки кадра выделяются на каждое объявление
+    constexpr Ref declareLocal(std::string_view name, PrimitiveDataType type, uint32_t cls) {
+        Ref r;
+        r.base = Local;
+        r.offset = frameSize;
+        r.type = type;
+        r.cls = cls;
+        frameSize += cls == None ? 1 : objectSize(cls);
+        locals.push_back(Symbol{name, r});
+        if (inMain && scopes.size() == 1 && cls == None) {
+            reports.push_back(Report{name, type, Local, r.offset});
+        }
+        return r;
+    }
+
+    constexpr Ref lookup(std::string_view name) const {
+        for (size_t i = locals.size(); i-- > 0;) {
+            if (locals[i].name == name) return locals[i].ref;
+        }
+        if (currentClass != None) {
+            if (const Member* m = findMember(currentClass, name)) {
+                Ref r;
+                r.base = This;
+                r.offset = m->offset;
+                r.type = m->type;
+                r.cls = m->cls;
+                r.method = m->method;
+                return r;
+            }
+        }
+        for (size_t i = globals.size(); i-- > 0;) {
+            if (globals[i].name == name) return globals[i].ref;
+        }
+        fail("Семантическая ошибка: идентификатор не объявлен");
+    }
+
+    // ---- разбор ----
+
+    constexpr PrimitiveDataType type(std::string_view& className) {
+        className = {};
+        if (code() == TInt) {
+            next();
+            return IntType;
+        }
+        if (code() == TDouble) {
+            next();
+            return DoubleType;
+        }
+        className = expectId();
+        return UndefinedType;
+    }
+
+    constexpr void program() {
+        while (code() == TClass || code() == TInt || code() == TDouble || code() == TId) {
+            if (code() == TInt && code(1) == TMain) break;
+            description();
+        }
+
+        expect(TInt);
+        expect(TMain);
+        expect(TLB);
+        expect(TRB);
+        expect(TLFB);
+        inMain = true;
+        frameSize = 0;
+        mainBody = block();
+        mainFrame = frameSize;
+        inMain = false;
+        expect(TRFB);
+        expect(TEnd);
+    }
+
+    constexpr void description() {
+        if (code() == TClass) {
+            classDesc();
+            return;
+        }
+
+        std::string_view className;
+        const PrimitiveDataType t = type(className);
+        const std::string_view name = expectId();
+        checkDuplicate(name);
+
+        Ref r;
+        r.type = t;
+        if (code() == TEval) {
+            // как в интерпретаторе: значение константы не сохраняется анализом
+            next();
+            if (code() != TConstInt && code() != TConstDouble) {
+                fail("вычисление при компиляции: ожидалась константа");
+            }
+            next();
+            expect(TSemicolon);
+            r.constant = true;
+            r.type = (t == DoubleType) ? DoubleType : IntType;
+            globals.push_back(Symbol{name, r});
+            reports.push_back(Report{name, r.type, Global, static_cast<uint32_t>(globalInit.size())});
+            globalInit.push_back(zero(r.type));
+            return;
+        }
+        expect(TSemicolon);
+
+        r.offset = static_cast<uint32_t>(globalInit.size());
+        if (t == UndefinedType) {
+            r.cls = objectClass(className);
+            const std::vector<TData>& proto = classes[r.cls].proto;
+            globalInit.insert(globalInit.end(), proto.begin(), proto.end());
+        } else {
+            reports.push_back(Report{name, t, Global, r.offset});
+            globalInit.push_back(zero(t));
+        }
+        globals.push_back(Symbol{name, r});
+    }
+
+    constexpr void classDesc() {
+        expect(TClass);
+        const std::string_view name = expectId();
+        checkDuplicate(name);
+        expect(TLFB);
+
+        currentClass = static_cast<uint32_t>(classes.size());
+        classes.push_back(Class{name, {}, {}});
+
+        while (code() == TInt || code() == TDouble || code() == TId) {
+            std::string_view className;
+            const PrimitiveDataType t = type(className);
+            std::string_view member = expectId();
+
+            if (code() == TLB) {
+                method(member, t);
+                continue;
+            }
+
+            while (true) {
+                checkDuplicate(member);
+                field(member, t, className);
+                if (code() != TComma) break;
+                next();
+                member = expectId();
+            }
+            expect(TSemicolon);
+        }
+
+        expect(TRFB);
+        expect(TSemicolon);
+        currentClass = None;
+    }
+
+    // поле неизвестного класса места не занимает, обращение к нему - ошибка
+    constexpr void field(std::string_view name, PrimitiveDataType t, std::string_view className) {
+        Class& cls = classes[currentClass];
+        Member m{name, static_cast<uint32_t>(cls.proto.size()), t, None, None};
+        if (t != UndefinedType) {
+            cls.proto.push_back(zero(t));
+        } else {
+            if (className == cls.name) fail("Семантическая ошибка: класс не может содержать поле своего типа");
+            m.cls = findClass(className);
+            if (m.cls != None) {
+                const std::vector<TData> inner = classes[m.cls].proto;
+                cls.proto.insert(cls.proto.end(), inner.begin(), inner.end());
+            }
+        }
+        cls.members.push_back(m);
+    }
+
+    constexpr void method(std::string_view name, PrimitiveDataType t) {
+        checkDuplicate(name);
+        expect(TLB);
+        expect(TRB);
+
+        const uint32_t index = static_cast<uint32_t>(methods.size());
+        methods.push_back(Method{t, None, 0});
+        classes[currentClass].members.push_back(Member{name, 0, t, None, index});
+
+        expect(TLFB);
+        frameSize = 0;
+        const uint32_t body = block();
+        methods[index].body = body;
+        methods[index].frame = frameSize;
+        expect(TRFB);
+    }
+
+    // тело до '}' в своей области
+    constexpr uint32_t block() {
+        beginScope();
+        std::vector<uint32_t> list;
+        while (code() != TRFB && code() != TEnd) {
+            operatorStmt(list);
+        }
+        endScope();
+        return addBlock(Stmt{}, list);
+    }
+
+    constexpr uint32_t addBlock(Stmt s, const std::vector<uint32_t>& list) {
+        s.first = static_cast<uint32_t>(children.size());
+        s.count = static_cast<uint32_t>(list.size());
+        children.insert(children.end(), list.begin(), list.end());
+        return add(s);
+    }
+
+    constexpr uint32_t add(const Stmt& s) {
+        stmts.push_back(s);
+        return static_cast<uint32_t>(stmts.size() - 1);
+    }
+
+    constexpr void operatorStmt(std::vector<uint32_t>& out) {
+        if (code() == TSemicolon) {
+            next();
+        } else if (code() == TLFB) {
+            next();
+            out.push_back(block());
+            expect(TRFB);
+        } else if (code() == TWhile) {
+            out.push_back(whileStmt());
+        } else if (code() == TReturn) {
+            next();
+            Stmt s;
+            s.kind = Stmt::Return;
+            s.expr = numeric(expression());
+            expect(TSemicolon);
+            out.push_back(add(s));
+        } else {
+            out.push_back(statement());
+        }
+    }
+
+    constexpr uint32_t whileStmt() {
+        Stmt s;
+        s.kind = Stmt::While;
+        expect(TWhile);
+        expect(TLB);
+        s.expr = numeric(expression());
+        expect(TRB);
+        std::vector<uint32_t> body;
+        operatorStmt(body);
+        return addBlock(s, body);
+    }
+
+    constexpr uint32_t statement() {
+        Stmt s;
+
+        if (code() == TInc || code() == TDec) {
+            s.kind = Stmt::Step;
+            s.op = code();
+            next();
+            s.target = lvalue(designator());
+            expect(TSemicolon);
+            return add(s);
+        }
+
+        if (code() == TInt || code() == TDouble) {
+            s.kind = Stmt::Decl;
+            s.type = (code() == TInt) ? IntType : DoubleType;
+            next();
+            const std::string_view name = expectId();
+            checkDuplicate(name);
+            if (code() == TEval) {
+                next();
+                s.expr = numeric(expression());
+            }
+            // инициализатор разобран до появления имени
+            s.target = declareLocal(name, s.type, None);
+            expect(TSemicolon);
+            return add(s);
+        }
+
+        // TypeName varName;
+        if (code() == TId && code(1) == TId) {
+            s.kind = Stmt::ObjectDecl;
+            s.cls = objectClass(expectId());
+            const std::string_view name = expectId();
+            checkDuplicate(name);
+            s.target = declareLocal(name, UndefinedType, s.cls);
+            expect(TSemicolon);
+            return add(s);
+        }
+
+        bool call = false;
+        s.target = designator(&call);
+        if (call) {
+            s.kind = Stmt::Call;
+        } else if (code() == TInc || code() == TDec) {
+            s.kind = Stmt::Step;
+            s.op = code();
+            s.target = lvalue(s.target);
+            next();
+        } else {
+            s.kind = Stmt::Assign;
+            switch (code()) {
+                case TEval:    s.op = TEval;  break;
+                case TPlusEq:  s.op = TPlus;  break;
+                case TMinusEq: s.op = TMinus; break;
+                case TMultEq:  s.op = TMult;  break;
+                case TDivEq:   s.op = TDiv;   break;
+                case TModEq:   s.op = TMod;   break;
+                default: fail("вычисление при компиляции: ожидалось присваивание");
+            }
+            s.target = lvalue(s.target);
+            next();
+            s.expr = numeric(expression());
+        }
+        expect(TSemicolon);
+        return add(s);
+    }
+
+    constexpr Ref lvalue(const Ref& r) const {
+        if (r.constant || r.method != None) {
+            fail("Семантическая ошибка: слева от присваивания должно быть изменяемое значение");
+        }
+        if (r.type != IntType && r.type != DoubleType) {
+            fail("Семантическая ошибка: присваивание возможно только для числовых типов");
+        }
+        return r;
+    }
+
+    constexpr Ref designator(bool* call = nullptr) {
+        Ref r = lookup(expectId());
+        while (code() == TPoint) {
+            next();
+            const std::string_view name = expectId();
+            if (r.method != None || r.cls == None) fail("Семантическая ошибка: обращение к члену не объекта");
+            const Member* m = findMember(r.cls, name);
+            if (!m) fail("Семантическая ошибка: нет такого члена класса");
+            if (m->method != None) {
+                r.method = m->method;
+            } else {
+                r.offset += m->offset;
+                r.cls = m->cls;
+            }
+            r.type = m->type;
+        }
+
+        if (code() == TLB) {
+            next();
+            expect(TRB);
+            if (r.method == None || !call) fail("Семантическая ошибка: вызов не метода");
+            *call = true;
+        } else if (r.method != None) {
+            fail("Семантическая ошибка: метод без вызова");
+        }
+        return r;
+    }
+
+    constexpr uint32_t add(const Expr& e) {
+        exprs.push_back(e);
+        return static_cast<uint32_t>(exprs.size() - 1);
+    }
+
+    constexpr uint32_t numeric(uint32_t e) const {
+        if (exprs[e].type != IntType && exprs[e].type != DoubleType) {
+            fail("Семантическая ошибка: объект в выражении");
+        }
+        return e;
+    }
+
+    constexpr uint32_t binary(uint16_t op, uint32_t l, uint32_t r) {
+        Expr e;
+        e.kind = Expr::Binary;
+        e.op = op;
+        e.left = numeric(l);
+        e.right = numeric(r);
+        if (isCompareOp(op)) {
+            e.type = IntType;
+        } else {
+            e.type = (exprs[l].type == DoubleType || exprs[r].type == DoubleType) ? DoubleType : IntType;
+        }
+        return add(e);
+    }
+
+    constexpr uint32_t expression() {
+        uint32_t left = sum();
+        if (isCompareOp(code())) {
+            const uint16_t op = code();
+            next();
+            left = binary(op, left, sum());
+        }
+        return left;
+    }
+
+    constexpr uint32_t sum() {
+        uint32_t acc = mult();
+        while (code() == TPlus || code() == TMinus) {
+            const uint16_t op = code();
+            next();
+            acc = binary(op, acc, mult());
+        }
+        return acc;
+    }
+
+    constexpr uint32_t mult() {
+        uint32_t acc = unary();
+        while (code() == TMult || code() == TDiv || code() == TMod) {
+            const uint16_t op = code();
+            next();
+            acc = binary(op, acc, unary());
+        }
+        return acc;
+    }
+
+    constexpr uint32_t unary() {
+        if (code() == TInc || code() == TDec) {
+            Expr e;
+            e.kind = Expr::PreInc;
+            e.op = code();
+            next();
+            e.ref = lvalue(designator());
+            e.type = e.ref.type;
+            return add(e);
+        }
+
+        const bool negate = (code() == TMinus);
+        if (code() == TPlus || code() == TMinus) {
+            next();
+        }
+
+        const uint32_t operand = base();
+        if (!negate) {
+            return operand;
+        }
+        Expr e;
+        e.kind = Expr::Neg;
+        e.left = numeric(operand);
+        e.type = exprs[operand].type;
+        return add(e);
+    }
+
+    constexpr uint32_t base() {
+        Expr e;
+
+        if (code() == TConstInt) {
+            e.type = IntType;
+            e.value = intConst(text());
+            next();
+            return add(e);
+        }
+        if (code() == TConstDouble) {
+            e.type = DoubleType;
+            e.value = doubleConst(text());
+            next();
+            return add(e);
+        }
+        if (code() == TLB) {
+            next();
+            const uint32_t inner = expression();
+            expect(TRB);
+            return inner;
+        }
+
+        bool call = false;
+        e.ref = designator(&call);
+        e.type = e.ref.type;
+        if (e.ref.constant) {
+            e.value = zero(e.type);
+        } else if (call) {
+            e.kind = Expr::Call;
+        } else if (code() == TInc || code() == TDec) {
+            e.kind = Expr::PostInc;
+            e.op = code();
+            e.ref = lvalue(e.ref);
+            next();
+        } else {
+            e.kind = Expr::Var;
+        }
+        return add(e);
+    }
+
+    // ---- выполнение ----
+
+    constexpr uint32_t address(const Ref& r) const {
+        return (r.base == Global ? 0 : (r.base == Local ? fp : self)) + r.offset;
+    }
+
+    // приведение при присваивании, как Parser::assignValue
+    static constexpr TData convert(const TData& v, PrimitiveDataType t) {
+        if (t == IntType) {
+            if (v.isInt()) return v;
+            return TData::Int(v.isDouble() ? truncToInt(v.asDouble()) : 0);
+        }
+        if (v.isDouble()) return v;
+        return TData::Double(v.isInt() ? static_cast<double>(v.asInt()) : 0.0);
+    }
+
+    static constexpr TData step(const TData& v, uint16_t op) {
+        if (v.isDouble()) {
+            return TData::Double(v.asDouble() + (op == TInc ? 1.0 : -1.0));
+        }
+        return TData::Int(op == TInc ? intArith<TPlus>(v.asInt(), 1) : intArith<TMinus>(v.asInt(), 1));
+    }
+
+    constexpr void execute() {
+        memory = globalInit;
+        mainFp = static_cast<uint32_t>(memory.size());
+        fp = mainFp;
+        memory.resize(memory.size() + mainFrame);
+        exec(mainBody);
+    }
+
+    // результат приводится к типу метода, как при присваивании
+    constexpr TData call(const Ref& r) {
+        const Method& m = methods[r.method];
+        const uint32_t receiver = address(r);
+        const uint32_t savedFp = fp;
+        const uint32_t savedSelf = self;
+
+        fp = static_cast<uint32_t>(memory.size());
+        self = receiver;
+        memory.resize(memory.size() + m.frame);
+        result = TData::Int(0);
+        exec(m.body);
+
+        TData value = result;
+        if (m.type == IntType || m.type == DoubleType) {
+            value = convert(value, m.type);
+        } else {
+            value.retag(TYPE_UNKNOWN);
+        }
+        memory.resize(fp);
+        fp = savedFp;
+        self = savedSelf;
+        returning = false;
+        return value;
+    }
+
+    constexpr TData eval(uint32_t index) {
+        const Expr& e = exprs[index];
+        switch (e.kind) {
+            case Expr::Const:
+                return e.value;
+            case Expr::Var:
+                return memory[address(e.ref)];
+            case Expr::Call:
+                return call(e.ref);
+            case Expr::PreInc:
+            case Expr::PostInc: {
+                TData& cell = memory[address(e.ref)];
+                const TData old = cell;
+                cell = step(cell, e.op);
+                return e.kind == Expr::PreInc ? cell : old;
+            }
+            case Expr::Neg: {
+                const TData v = eval(e.left);
+                if (v.isDouble()) return TData::Double(-v.asDouble());
+                return TData::Int(intArith<TMinus>(0, v.asInt()));
+            }
+            case Expr::Binary: {
+                const TData l = eval(e.left);
+                const TData r = eval(e.right);
+                return binaryValue(e.op, l, r);
+            }
+        }
+        return TData();
+    }
+
+    constexpr void execList(const Stmt& s) {
+        for (uint32_t i = 0; i < s.count && !returning; ++i) {
+            exec(children[s.first + i]);
+        }
+    }
+
+    constexpr void exec(uint32_t index) {
+        const Stmt& s = stmts[index];
+        switch (s.kind) {
+            case Stmt::Block:
+                execList(s);
+                return;
+
+            case Stmt::Decl: {
+                // вызов в инициализаторе может перевыделить memory
+                const TData v = s.expr == None ? zero(s.type) : convert(eval(s.expr), s.type);
+                memory[address(s.target)] = v;
+                return;
+            }
+
+            case Stmt::ObjectDecl: {
+                const std::vector<TData>& proto = classes[s.cls].proto;
+                const uint32_t at = address(s.target);
+                for (uint32_t i = 0; i < proto.size(); ++i) {
+                    memory[at + i] = proto[i];
+                }
+                return;
+            }
+
+            case Stmt::Assign: {
+                // текущее значение читается после правой части
+                TData v = eval(s.expr);
+                TData& cell = memory[address(s.target)];
+                if (s.op != TEval) {
+                    v = binaryValue(s.op, cell, v);
+                }
+                cell = convert(v, s.target.type);
+                return;
+            }
+
+            case Stmt::Step: {
+                TData& cell = memory[address(s.target)];
+                cell = step(cell, s.op);
+                return;
+            }
+
+            case Stmt::Call:
+                (void)call(s.target);
+                return;
+
+            case Stmt::While:
+                while (!returning) {
+                    const TData c = eval(s.expr);
+                    if (c.isDouble() ? !(c.asDouble() != 0.0) : c.asInt() == 0) break;
+                    execList(s);
+                }
+                return;
+
+            case Stmt::Return:
+                result = eval(s.expr);
+                returning = true;
+                return;
+        }
+    }
+};
+
+constexpr ConstValues evaluateProgram(std::string_view source) {
+    return ConstEvaluator(source).run();
+}
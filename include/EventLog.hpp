@@ -0,0 +1,97 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <string>
+
+#include "Tree.hpp"
+
+// Двоичный журнал выполнения: вместо печати присваиваний интерпретатор
+// пишет записи фиксированного размера в файл, отображённый в память.
+// Расшифровывает его отдельная программа cppTranslatorLog.
+//
+// Файл: заголовок EventLogHeader, записи EventRecord подряд, затем таблица
+// имён (длина uint32_t и байты) - номера имён совпадают с NameTable.
+// Таблица и число записей пишутся при закрытии; если процесс завершился
+// раньше, записи читаются до первой нулевой, имена остаются номерами.
+
+enum EventKind : uint8_t {
+    EventNone,
+    EventAssign,    // id - имя designator'а или переменной, value - новое значение
+    EventEnter,     // id - имя метода
+    EventExit,      // id - имя метода, value - результат
+    EventLoop,      // id - номер цикла, проход интерпретатора
+    EventReturn     // value - значение return
+};
+
+enum EventValueType : uint8_t { EventNoValue, EventInt, EventDouble };
+
+struct EventRecord {
+    uint8_t kind = EventNone;
+    uint8_t type = EventNoValue;
+    uint16_t reserved = 0;
+    uint32_t id = 0;
+    uint64_t value = 0;     // int - младшие 32 бита, double - биты значения
+};
+
+static_assert(sizeof(EventRecord) == 16);
+
+struct EventLogHeader {
+    static constexpr uint32_t Version = 1;
+
+    char magic[8] = {'C', 'P', 'P', 'T', 'L', 'O', 'G', '\0'};
+    uint32_t version = Version;
+    uint32_t recordSize = sizeof(EventRecord);
+    uint64_t count = 0;         // 0 - журнал не закрыт
+    uint64_t namesOffset = 0;
+    uint64_t nameCount = 0;
+    uint8_t reserved[24] = {};
+};
+
+static_assert(sizeof(EventLogHeader) == 64);
+
+class EventLog {
+public:
+    explicit EventLog(const std::string& path);
+    ~EventLog();
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    void assign(uint32_t nameId, const TData& v) { append(EventAssign, nameId, v); }
+    void enter(uint32_t nameId) { append(EventEnter, nameId, TData()); }
+    void exit(uint32_t nameId, const TData& v) { append(EventExit, nameId, v); }
+    void loop(uint32_t loopId) { append(EventLoop, loopId, TData()); }
+    void ret(const TData& v) { append(EventReturn, 0, v); }
+
+    // дописывает таблицу имён и заголовок
+    void close();
+
+private:
+    static constexpr uint64_t InitialCapacity = 1u << 20;
+
+    int fd = -1;
+    void* base = nullptr;               // отображение файла
+    EventRecord* records = nullptr;     // записи после заголовка
+    uint64_t count = 0;
+    uint64_t capacity = 0;
+
+    void map(uint64_t newCapacity);
+    void unmap();
+
+    void append(EventKind kind, uint32_t id, const TData& v) {
+        if (count == capacity) {
+            map(capacity * 2);
+        }
+        EventRecord& r = records[count++];
+        r.kind = kind;
+        r.id = id;
+        if (v.isDouble()) {
+            r.type = EventDouble;
+            r.value = std::bit_cast<uint64_t>(v.asDouble());
+        } else if (v.isInt()) {
+            r.type = EventInt;
+            r.value = static_cast<uint32_t>(v.asInt());
+        }
+    }
+};
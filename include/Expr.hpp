@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+
+#include "TokenType.hpp"
+#include "Tree.hpp"
+
+struct DesignatorSite;
+
+// Бинарная операция, специализированная по статическим типам операндов.
+using BinaryFn = TData (*)(const TData& l, const TData& r);
+
+BinaryFn binaryFn(uint16_t op, PrimitiveDataType lt, PrimitiveDataType rt);
+
+// Сравнение, сразу дающее переход: результат не упаковывается в TData.
+using CompareFn = bool (*)(const TData& l, const TData& r);
+
+CompareFn compareFn(uint16_t op, PrimitiveDataType lt, PrimitiveDataType rt);
+
+constexpr bool isCompareOp(uint16_t op) {
+    return op == TL || op == TG || op == TLE || op == TGE || op == TEq || op == TNotEq;
+}
+
+template <typename T>
+constexpr T valueOf(const TData& v) {
+    if constexpr (std::is_same_v<T, double>) return v.asDouble();
+    else return v.asInt();
+}
+
+template <typename T>
+constexpr TData makeData(T v) {
+    if constexpr (std::is_same_v<T, double>) return TData::Double(v);
+    else return TData::Int(v);
+}
+
+// Предупреждение в std::cerr; при вычислении во время компиляции не печатается.
+constexpr void warn(const char* text) {
+    if (!std::is_constant_evaluated()) {
+        std::cerr << text << std::endl;
+    }
+}
+
+// static_cast<int> как cvttsd2si: NaN и выход за диапазон дают INT32_MIN
+constexpr int truncToInt(double v) {
+    return (v > -2147483649.0 && v < 2147483648.0) ? static_cast<int>(v) : INT32_MIN;
+}
+
+// Деление int по модулю 2^32, как сложение: INT_MIN / -1 == INT_MIN,
+// INT_MIN % -1 == 0; на 0 - 0 (предупреждение печатает вызывающий).
+// Этим же правилам следуют rt_div/rt_mod генератора C++, idiv в AsmGen и JIT.
+constexpr int wrapDiv(int a, int b) {
+    if (b == 0) return 0;
+    return (b == -1) ? static_cast<int>(0u - static_cast<uint32_t>(a)) : a / b;
+}
+constexpr int wrapMod(int a, int b) {
+    return (b == 0 || b == -1) ? 0 : a % b;
+}
+
+// int-арифметика с переполнением по модулю 2^32
+template <uint16_t Op>
+constexpr int intArith(int a, int b) {
+    const uint32_t ua = static_cast<uint32_t>(a);
+    const uint32_t ub = static_cast<uint32_t>(b);
+    if constexpr (Op == TPlus) return static_cast<int>(ua + ub);
+    else if constexpr (Op == TMinus) return static_cast<int>(ua - ub);
+    else if constexpr (Op == TMult) return static_cast<int>(ua * ub);
+    else if constexpr (Op == TDiv) {
+        if (b == 0) {
+            warn("Warning: division by zero (int)");
+        }
+        return wrapDiv(a, b);
+    } else {
+        if (b == 0) {
+            warn("Warning: modulo by zero");
+        }
+        return wrapMod(a, b);
+    }
+}
+
+template <uint16_t Op>
+constexpr double doubleArith(double a, double b) {
+    if constexpr (Op == TPlus) return a + b;
+    else if constexpr (Op == TMinus) return a - b;
+    else if constexpr (Op == TMult) return a * b;
+    else if constexpr (Op == TDiv) {
+        if (b == 0.0) {
+            warn("Warning: division by zero (double)");
+        }
+        return (b != 0.0) ? (a / b) : 0.0;
+    } else {
+        warn("Warning: operator % for double, casting to int");
+        return wrapMod(truncToInt(a), truncToInt(b));
+    }
+}
+
+template <uint16_t Op, typename T>
+constexpr bool compareOp(T a, T b) {
+    if constexpr (Op == TL) return a < b;
+    else if constexpr (Op == TG) return a > b;
+    else if constexpr (Op == TLE) return a <= b;
+    else if constexpr (Op == TGE) return a >= b;
+    else if constexpr (Op == TEq) return a == b;
+    else return a != b;
+}
+
+// Операнды приводятся к общему типу явно: int расширяется до double.
+template <typename L, typename R>
+using CommonType = std::conditional_t<std::is_same_v<L, double> || std::is_same_v<R, double>,
+                                      double, int>;
+
+template <uint16_t Op, typename L, typename R>
+constexpr bool compareBranch(const TData& l, const TData& r) {
+    using T = CommonType<L, R>;
+    return compareOp<Op>(static_cast<T>(valueOf<L>(l)), static_cast<T>(valueOf<R>(r)));
+}
+
+template <uint16_t Op, typename L, typename R>
+constexpr TData binaryOp(const TData& l, const TData& r) {
+    using T = CommonType<L, R>;
+    const T a = static_cast<T>(valueOf<L>(l));
+    const T b = static_cast<T>(valueOf<R>(r));
+
+    if constexpr (isCompareOp(Op)) {
+        return makeData<int>(compareBranch<Op, L, R>(l, r) ? 1 : 0);
+    } else if constexpr (std::is_same_v<T, double>) {
+        return makeData<double>(doubleArith<Op>(a, b));
+    } else {
+        return makeData<int>(intArith<Op>(a, b));
+    }
+}
+
+// Операция по тегам значений, без таблиц binaryFn: для вычисления при
+// компиляции (ConstEval.hpp). Неопределённое значение читается как int.
+template <uint16_t Op>
+constexpr TData binaryByTags(const TData& l, const TData& r) {
+    if (l.isDouble()) {
+        return r.isDouble() ? binaryOp<Op, double, double>(l, r) : binaryOp<Op, double, int>(l, r);
+    }
+    return r.isDouble() ? binaryOp<Op, int, double>(l, r) : binaryOp<Op, int, int>(l, r);
+}
+
+constexpr TData binaryValue(uint16_t op, const TData& l, const TData& r) {
+    switch (op) {
+        case TPlus:  return binaryByTags<TPlus>(l, r);
+        case TMinus: return binaryByTags<TMinus>(l, r);
+        case TMult:  return binaryByTags<TMult>(l, r);
+        case TDiv:   return binaryByTags<TDiv>(l, r);
+        case TMod:   return binaryByTags<TMod>(l, r);
+        case TL:     return binaryByTags<TL>(l, r);
+        case TG:     return binaryByTags<TG>(l, r);
+        case TLE:    return binaryByTags<TLE>(l, r);
+        case TGE:    return binaryByTags<TGE>(l, r);
+        case TEq:    return binaryByTags<TEq>(l, r);
+        default:     return binaryByTags<TNotEq>(l, r);
+    }
+}
+
+enum ExprKind : uint8_t {
+    ExprConst,      // литерал
+    ExprVar,        // чтение переменной, поля или константы
+    ExprCall,       // вызов метода
+    ExprPreInc,     // ++x, --x
+    ExprPostInc,    // x++, x--
+    ExprNeg,        // унарный минус
+    ExprBinary,     // бинарная операция
+    ExprGroup,      // граница Expression: печать результата выражения
+    ExprTemp,       // повтор уже вычисленного значения (ячейка временных)
+    ExprInline      // вызов метода вида { return выражение; }, тело в left
+};
+
+// Узел разобранного выражения. Строится при первом разборе (анализ),
+// при выполнении Expression вычисляет дерево и перематывает его токены.
+struct ExprNode {
+    static constexpr uint16_t NoTemp = UINT16_MAX;
+
+    ExprKind kind = ExprConst;
+    PrimitiveDataType type = UndefinedType;
+    uint16_t op = 0;                // бинарная операция, ++/-- или число временных тела (ExprInline)
+    bool traceStep = false;         // Sum/Mult печатают шаг после операции
+    uint16_t temp = NoTemp;         // куда сохранить значение (для ExprTemp - откуда взять)
+    uint32_t hoist = UINT32_MAX;    // инвариант цикла: номер ячейки в hoistSlots
+    BinaryFn fn = nullptr;
+    TData value;                    // ExprConst
+    const DesignatorSite* site = nullptr;
+    ExprNode* left = nullptr;
+    ExprNode* right = nullptr;
+};
+
+struct CompiledExpr {
+    ExprNode* root = nullptr;
+    uint32_t endPos = 0;            // начало токена, следующего за выражением
+    uint16_t tempCount = 0;
+};
+
+// Значение инвариантного подвыражения, вычисленное в текущем проходе цикла.
+struct HoistSlot {
+    TData value;
+    uint64_t gen = 0;               // проход цикла, в котором вычислено
+    uint32_t loop = 0;
+};
+
+// Нумерация значений внутри выражения: повторные чтения одной ячейки и
+// одинаковые подвыражения между побочными эффектами (вызов, ++/--)
+// вычисляются один раз. Возвращает число временных ячеек.
+uint16_t numberValues(ExprNode* root);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Expr.hpp"
+
+// Машинный код x86-64 (Linux) для горячих циклов из обновлений и встроенных
+// методов. Где генерация недоступна, компиляция не удаётся и выполнение
+// остаётся за интерпретатором.
+
+// Кадр: ячейки цикла (int - в младших 32 битах, double - биты числа), за
+// ними временные выражений. Выполняет не больше max проходов и возвращает
+// их число; значение каждого обновления после прохода пишется в log.
+using JitLoopFn = uint64_t (*)(int64_t* frame, int64_t* log, uint64_t max);
+
+// Тело метода { return выражение; } над блоком получателя.
+// Результат - int в младших 32 битах или биты double.
+using JitMethodFn = uint64_t (*)(const TData* receiver, int64_t* temps);
+
+// Цикл while из обновлений v += e, v -= e, ++v, v++. Записываемые ячейки
+// живут в регистрах, остальные читаются из кадра.
+struct JitLoop {
+    struct Cell {
+        const DesignatorSite* site = nullptr;   // для поиска ячейки при входе
+        PrimitiveDataType type = UndefinedType;
+        bool written = false;
+    };
+    struct Update {
+        uint32_t cell = 0;
+        uint16_t op = 0;                        // TPlus/TMinus или TInc/TDec
+        const CompiledExpr* step = nullptr;
+    };
+
+    std::vector<Cell> cells;
+    std::unordered_map<const DesignatorSite*, uint32_t> cellOf;
+    const CompiledExpr* cond = nullptr;
+    std::vector<Update> updates;
+
+    JitLoopFn fn = nullptr;
+    uint32_t frameSize = 0;
+};
+
+// Чтение ExprVar в теле метода: поле получателя или глобальная по адресу.
+struct JitRead {
+    bool field = false;
+    uint32_t offset = 0;
+    const TData* address = nullptr;
+};
+
+struct JitMethod {
+    std::unordered_map<const DesignatorSite*, JitRead> reads;
+    JitMethodFn fn = nullptr;
+    uint32_t calls = 0;
+    bool tried = false;
+};
+
+// Исполняемая память: код живёт до конца выполнения программы.
+class JitBuffer {
+public:
+    JitBuffer() = default;
+    JitBuffer(const JitBuffer&) = delete;
+    JitBuffer& operator=(const JitBuffer&) = delete;
+    ~JitBuffer();
+
+    bool compileLoop(JitLoop& loop);
+    bool compileMethod(const CompiledExpr& body, JitMethod& method);
+
+private:
+    void* install(const std::vector<uint8_t>& code);
+
+    std::vector<std::pair<void*, size_t>> regions;
+};
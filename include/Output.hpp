@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <thread>
+
+// Кольцо байтов для одного писателя и одного читателя без блокировок:
+// head двигает только писатель, tail - только читатель.
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity);     // степень двойки
+
+    // сколько байт из n поместилось
+    size_t push(const char* data, size_t n);
+    // непрерывный участок готовых к чтению байт
+    size_t readable(const char*& data) const;
+    // то же, начиная с позиции from между tail и head
+    size_t readableFrom(size_t from, const char*& data) const;
+    void pop(size_t n);
+
+    bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+
+private:
+    std::unique_ptr<char[]> bytes;
+    size_t mask;
+};
+
+// Буфер std::cout, который выводит в файловый дескриптор из фонового
+// потока. Строки копятся в буфере основного потока и целыми блоками
+// передаются через SpscRing; фоновый поток пишет их большими write(2).
+// std::endl и flush потока вывод не сбрасывают. Сбрасывает flush() -
+// при закрытии и перед выводом в std::cerr, если привязать его к tie():
+// flush() ждёт, пока записано всё переданное, поэтому порядок строк
+// stdout и stderr не меняется.
+class AsyncOutput : public std::streambuf {
+public:
+    static constexpr size_t BlockSize = 64 * 1024;
+    static constexpr size_t RingSize = 1024 * 1024;
+
+    explicit AsyncOutput(int fd);
+    ~AsyncOutput() override;
+
+    AsyncOutput(const AsyncOutput&) = delete;
+    AsyncOutput& operator=(const AsyncOutput&) = delete;
+
+    // записывает всё переданное и ждёт фоновый поток
+    void flush();
+    // записывает всё и останавливает фоновый поток
+    void close();
+
+    // поток для std::cerr.tie(): его сброс вызывает flush()
+    std::ostream& tie() { return tieStream; }
+
+    // До close() при SIGSEGV, SIGFPE, SIGABRT, SIGBUS и SIGILL накопленный
+    // вывод пишется в fd обработчиком сигнала, затем сигнал повторяется.
+    void flushOnCrash();
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int sync() override;
+
+private:
+    class TieBuf : public std::streambuf {
+    public:
+        explicit TieBuf(AsyncOutput& owner) : owner(owner) {}
+
+    protected:
+        int sync() override {
+            owner.flush();
+            return 0;
+        }
+
+    private:
+        AsyncOutput& owner;
+    };
+
+    int fd;
+    std::unique_ptr<char[]> block;
+    SpscRing ring;
+
+    std::atomic<uint64_t> signal{0};    // растёт при передаче блока и при закрытии
+    std::atomic<bool> closing{false};
+    std::thread writer;
+
+    TieBuf tieBuf{*this};
+    std::ostream tieStream{&tieBuf};
+
+    static void crashHandler(int sig);
+    void restoreHandlers();
+
+    void handOff();
+    void drain();
+    void writeLoop();
+    void writeAll(const char* data, size_t n);
+};
@@ -1,20 +1,146 @@
 #pragma once
 
+#include <deque>
+#include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "EventLog.hpp"
+#include "Expr.hpp"
+#include "Jit.hpp"
 #include "Scanner.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
 #include "Tree.hpp"
 
+// Разрешённый designator (a, a.b.c, a.m()), запоминается по позиции первого
+// идентификатора. Корень цепочки - либо ячейка кадра (локальная переменная,
+// узел которой создаётся заново при каждом выполнении объявления), либо
+// постоянный узел (глобальное объявление, член класса).
+struct DesignatorSite {
+    Tree* root = nullptr;
+    uint32_t frameSlot = Node::NoSlot;
+    Tree* member = nullptr;     // последний член цепочки (узел внутри класса)
+    uint32_t memberOffset = 0;  // суммарное смещение членов цепочки в блоке объекта
+
+    std::string fullName;
+    uint32_t nameId = NameTable::NoName;    // fullName в NameTable (журнал событий)
+    uint32_t endPos = 0;        // начало токена, следующего за designator
+
+    bool isMethodCall = false;
+    bool isLValue = false;
+    PrimitiveDataType type = UndefinedType;
+
+    uint32_t version = Node::NoSlot;    // счётчик записей поля/глобальной (у локальных нет)
+};
+
+// Раскладка полей класса: начальные значения всех скалярных ячеек
+// экземпляра, поля-объекты развёрнуты на месте.
+struct ClassLayout {
+    std::vector<TData> proto;
+};
+
+// Цикл while при анализе: выражения внутри него и ячейки, которые он пишет.
+// Ячейка - корень designator'а (ячейка кадра или узел) и смещение члена.
+struct LoopInfo {
+    static constexpr uint32_t WholeRoot = UINT32_MAX;
+
+    // оператор тела вида v += e, v -= e, v++, v--
+    struct Update {
+        const DesignatorSite* site = nullptr;
+        uint16_t op = 0;                    // TPlus/TMinus или TInc/TDec
+        const CompiledExpr* step = nullptr; // правая часть += и -=
+        PrimitiveDataType stepType = UndefinedType;
+        bool invariant = false;             // правая часть вычисляется один раз
+    };
+
+    std::vector<ExprNode*> exprs;
+    std::set<std::pair<uint64_t, uint32_t>> writes;
+    bool hasCall = false;   // вызов метода может менять поля и глобальные
+
+    // тело из одних обновлений выполняется без разбора
+    std::vector<Update> updates;
+    bool onlyUpdates = true;
+    bool bodySeen = false;
+    bool direct = false;
+    const CompiledExpr* cond = nullptr;
+    uint32_t endPos = 0;                // начало токена после тела
+
+    // условие из одного сравнения переменных и литералов
+    CompareFn test = nullptr;
+    const ExprNode* testLeft = nullptr;
+    const ExprNode* testRight = nullptr;
+
+    // Условие "счётчик rel граница" с инвариантной границей. Без тела
+    // (i++ < n) итоговое значение счётчика считается сразу, с телом
+    // (i < n, i += шаг) оно развёртывается в unroll копий.
+    const ExprNode* counter = nullptr;
+    const ExprNode* bound = nullptr;
+    uint16_t rel = 0;
+    uint32_t unroll = 0;
+    bool reduction = false;             // накопители можно считать в потоках
+    bool never = false;                 // условие - ложная константа, тело не выполняется
+
+    // проходы в интерпретаторе до компиляции в машинный код
+    uint32_t runs = 0;
+    bool jitTried = false;
+    JitLoop jit;
+};
+
+// Метод только для чтения: не пишет поля и глобальные, ничего не печатает и
+// вызывает только такие же методы. Результат запоминается по получателю.
+struct MethodMemo {
+    struct Entry {
+        TData value;
+        uint64_t epoch = 0;     // момент вычисления
+    };
+
+    bool pure = true;
+    std::vector<uint32_t> reads;    // счётчики прочитанных полей и глобальных
+    std::unordered_map<TData*, Entry> cache;
+};
+
+// Состояние вызывающего, сохраняемое на время вызова метода. Записи лежат
+// в заранее выделенном стеке callFrames; текущий токен не копируется, а
+// сканируется заново с resumePos.
+struct CallFrame {
+    Tree* scope = nullptr;          // текущая область дерева
+    Tree* func = nullptr;
+    TData* receiver = nullptr;      // thisBlock
+    TData returnValue;
+    uint32_t resumePos = 0;         // начало текущего токена
+    uint32_t frameBase = 0;
+    PrimitiveDataType returnType = UndefinedType;
+    bool interpret = false;
+    bool returning = false;
+};
+
+struct ParserOptions {
+    bool optimize = true;   // свёртка констант и нумерация значений в выражениях
+    uint32_t inlineLimit = 16;  // наибольший размер встраиваемого тела (узлов), 0 - не встраивать
+    uint32_t unroll = 0;        // копий тела счётного цикла, 0 - по размеру тела, 1 - не развёртывать
+    uint32_t threads = 0;       // потоков для циклов-редукций, 0 - по числу ядер, 1 - без потоков
+    uint32_t jit = 64;          // проходов цикла или вызовов метода до машинного кода, 0 - без него
+    bool quiet = false;         // генераторы кода: программа не печатает присваивания
+    std::string eventLog;       // двоичный журнал событий вместо печати присваиваний
+};
+
 class Parser {
 public:
-    Parser(Scanner* scanner);
+    Parser(Scanner* scanner, const ParserOptions& options = ParserOptions());
     ~Parser();
 
     void parse();
 
+    // только анализ: дерево и designator'ы для генераторов кода
+    void analyse();
+    const DesignatorSite* siteAt(uint32_t pos) const;
+
 private:
     Scanner* scanner;
+    ParserOptions options;
 
     std::string currentToken;
     uint16_t currentTokenCode;
@@ -24,6 +150,7 @@ private:
 
     PrimitiveDataType exprType;
     TData exprValue;
+    ExprNode* exprNode;     // дерево последнего разобранного (под)выражения
 
     bool flagInterpret;
     bool flagReturn;
@@ -34,7 +161,60 @@ private:
     Tree* mainTree;
     uint32_t mainBodyPos;
 
-    std::unordered_map<Tree*, uint32_t> methodBodyPos;
+    std::unordered_map<Tree*, CompiledExpr> inlineBodies;  // методы вида { return выражение; }
+    uint32_t lastReturnExprPos;
+
+    std::unordered_map<uint32_t, DesignatorSite> designatorCache;
+
+    // списки операторов: начало -> закрывающая '}', остаток после return пропускается
+    std::unordered_map<uint32_t, uint32_t> listEnds;
+
+    // стек записей вызовов методов, растёт только при более глубокой рекурсии
+    static constexpr uint32_t InitialCallDepth = 256;
+    std::vector<CallFrame> callFrames;
+    uint32_t callDepth;
+
+    std::vector<ClassLayout> classLayouts;
+    std::vector<std::unique_ptr<TData[]>> objectBlocks;
+    TData* thisBlock;   // блок объекта, метод которого сейчас выполняется
+
+    // кадры локальных переменных: ячейка -> узел текущего экземпляра объявления
+    std::vector<Tree*> frameSlots;
+    uint32_t frameBase;
+    Tree* currentFunc;  // main или метод, тело которого разбирается/выполняется
+    std::unordered_map<uint32_t, uint32_t> declSlots;  // позиция объявления -> ячейка
+
+    // выражения, построенные при анализе, по позиции начала
+    std::deque<ExprNode> exprNodes;
+    std::unordered_map<uint32_t, CompiledExpr> exprCache;
+    uint32_t exprDepth;             // вложенность Expression при разборе
+    std::vector<TData> exprTemps;   // временные ячейки выполняемых выражений
+    uint32_t tempBase;
+
+    // вынос инвариантов из циклов
+    std::vector<LoopInfo> loops;
+    std::unordered_map<uint32_t, uint32_t> loopIds;     // позиция условия -> цикл
+    std::vector<uint32_t> loopStack;                    // циклы, разбираемые при анализе
+    std::vector<uint64_t> loopGens;                     // текущий проход каждого цикла
+    uint64_t loopGenCounter;
+    std::vector<HoistSlot> hoistSlots;
+
+    // запоминание результатов методов только для чтения
+    std::unordered_map<Node*, uint32_t> versionSlots;   // поле/глобальная -> счётчик
+    std::vector<uint64_t> fieldVersions;                // момент последней записи
+    uint64_t writeEpoch;
+    std::unordered_map<Tree*, MethodMemo> methodMemos;
+    MethodMemo* analysedMemo;                           // метод, тело которого разбирается
+
+    // машинный код горячих циклов и встроенных методов
+    JitBuffer jitCode;
+    std::unordered_map<const ExprNode*, JitMethod> jitMethods;  // по корню тела
+    std::vector<int64_t> jitTemps;
+
+    std::unique_ptr<ThreadPool> workers;    // циклы-редукции, создаётся при первом блоке
+
+    std::string lineText;   // строка печати присваивания, память переиспользуется
+    std::unique_ptr<EventLog> events;   // при options.eventLog
 
     void nextToken();
 
@@ -48,24 +228,67 @@ private:
     uint32_t getUK() const;
     void setUK(uint32_t uk);
 
-    void debugFlag(const std::string& where);
-    void debugEvent(const std::string& msg);
+    // отладочная печать по уровню из Trace.hpp; части сообщения
+    // выводятся подряд, без сборки строки
+    void debugFlag(const char* where);
+    template <typename... Parts>
+    void debugEvent(const Parts&... parts);
 
     void resetExpr();
 
-    void printAssignment(const Node* dest, const std::string& fullName = std::string());
-    void assignValue(Node* dest, PrimitiveDataType destType, const TData& srcValue);
+    void printAssignment(uint32_t nameId, const TData& value);
+    void assignValue(Node* decl, TData& dest, PrimitiveDataType destType, const TData& srcValue);
 
+    template <TraceLevel Level>
     void debugValue(const char* label, const TData& v, PrimitiveDataType t);
 
     TData evalBinary(uint16_t op,
                      const TData& l, PrimitiveDataType lt,
                      const TData& r, PrimitiveDataType rt,
                      PrimitiveDataType& resultType);
+    TData runBinary(uint16_t op, BinaryFn fn, const TData& l, const TData& r);
+
+    ExprNode* newExprNode(ExprKind kind, PrimitiveDataType type);
+    ExprNode* binaryNode(uint16_t op, ExprNode* l, ExprNode* r, PrimitiveDataType resType, bool traceStep);
+    TData evalExpr(const ExprNode* e);
+    TData evalNode(const ExprNode* e);
+    TData evalRoot(const ExprNode* root, uint16_t tempCount);
+    TData evalInline(const ExprNode* call, TData* receiver);
+    TData stepPlace(Node* decl, TData& place, PrimitiveDataType t, uint16_t op, bool postfix);
+
+    TData execMethod(Tree* methodNode, const std::string& fullName, TData* receiver);
+
+    Tree* parseDesignator(bool allowMethodCall, const DesignatorSite*& site, TData*& place);
+    Tree* resolveSite(const DesignatorSite& site);
+    TData* sitePlace(const DesignatorSite& site, Tree* root);
+
+    void layoutField(Tree* classNode, Node* field);
+    uint32_t allocObject(Tree* classNode);
+
+    uint32_t enterFrame(Tree* func);
+    void leaveFrame(uint32_t savedBase, Tree* savedFunc);
+    void bindLocal(Tree* varNode, uint32_t declPos);
 
-    TData execMethod(Tree* methodNode, const std::string& fullName);
+    void noteWrite(const DesignatorSite* site);
+    void noteCall(const DesignatorSite* site);
+    void hoistInvariants(uint32_t loopId);
+    void noteUpdate(const DesignatorSite* site, uint16_t op, uint32_t stepPos);
+    void noteComplexStatement();
+    void classifyLoop(uint32_t loopId, uint32_t condPos);
+    void runDirectLoop(uint32_t loopId);
+    void runReductionBlock(const LoopInfo& loop, const std::vector<TData*>& places,
+                           const std::vector<int64_t>& deltas, int64_t d,
+                           uint32_t count, unsigned threads);
+    const TData& testOperand(const ExprNode* n);
+    bool loopCondition(const LoopInfo& loop);
+    bool runClosedForm(const LoopInfo& loop);
+    void jitLoop(LoopInfo& loop);
+    bool runJitBlock(const LoopInfo& loop, bool& finished);
+    void jitMethod(const ExprNode* call, JitMethod& method);
 
-    Tree* parseDesignator(bool allowMethodCall, bool& isMethodCall, std::string& fullName);
+    void touch(const DesignatorSite* site);
+    void noteRead(const DesignatorSite* site);
+    void markImpure();
 
     void Program();
     void GlobalDescriptions();
@@ -75,6 +298,7 @@ private:
     void ClassBody();
     void MemberDeclaration();
     void Method();
+    void recordInlineBody(Tree* methodNode);
     void Field();
 
     void Type();
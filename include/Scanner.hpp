@@ -1,13 +1,130 @@
 #pragma once
 
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
 #include "TokenType.hpp"
 
+// Разбор одного токена: общий для Scanner и для вычисления программы при
+// компиляции (ConstEval.hpp), поэтому constexpr и без состояния. Текст
+// заканчивается '\0' или концом string_view.
+struct Lexeme {
+    uint16_t code = TEnd;
+    uint32_t start = 0;
+    uint32_t length = 0;
+    const char* error = nullptr;    // для Terr
+};
+
+constexpr bool isDigitChar(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+constexpr bool isLetterChar(char ch) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+constexpr uint16_t keywordCode(std::string_view word) {
+    if (word == "int") return TInt;
+    if (word == "double") return TDouble;
+    if (word == "void") return TVoid;
+    if (word == "class") return TClass;
+    if (word == "while") return TWhile;
+    if (word == "return") return TReturn;
+    if (word == "main") return TMain;
+    return TId;
+}
+
+constexpr Lexeme scanLexeme(std::string_view text, uint32_t& pos, uint32_t& line) {
+    auto at = [&](uint32_t i) { return i < text.size() ? text[i] : '\0'; };
+
+    while (at(pos) == ' ' || at(pos) == '\t' || at(pos) == '\n') {
+        if (at(pos) == '\n') line++;
+        pos++;
+    }
+
+    Lexeme lx;
+    lx.start = pos;
+    auto done = [&](uint16_t code) {
+        lx.code = code;
+        lx.length = pos - lx.start;
+        return lx;
+    };
+    // односимвольный оператор или он же с продолжением second
+    auto pair = [&](char second, uint16_t single, uint16_t twin) {
+        pos++;
+        if (at(pos) != second) return done(single);
+        pos++;
+        return done(twin);
+    };
+
+    const char ch = at(pos);
+    if (ch == '\0') {
+        return done(TEnd);
+    }
+
+    if (isDigitChar(ch)) {
+        while (isDigitChar(at(pos))) pos++;
+        if (at(pos) != '.') return done(TConstInt);
+
+        pos++;
+        if (!isDigitChar(at(pos))) {
+            lx.error = "некорректная константа";
+            return done(Terr);
+        }
+        while (isDigitChar(at(pos))) pos++;
+        return done(TConstDouble);
+    }
+
+    if (isLetterChar(ch)) {
+        while (isLetterChar(at(pos)) || isDigitChar(at(pos))) pos++;
+        return done(keywordCode(text.substr(lx.start, pos - lx.start)));
+    }
+
+    switch (ch) {
+        case '.': pos++; return done(TPoint);
+        case ',': pos++; return done(TComma);
+        case ';': pos++; return done(TSemicolon);
+        case '(': pos++; return done(TLB);
+        case ')': pos++; return done(TRB);
+        case '{': pos++; return done(TLFB);
+        case '}': pos++; return done(TRFB);
+        case '=': return pair('=', TEval, TEq);
+        case '/': return pair('=', TDiv, TDivEq);
+        case '*': return pair('=', TMult, TMultEq);
+        case '%': return pair('=', TMod, TModEq);
+        case '>': return pair('=', TG, TGE);
+        case '<': return pair('=', TL, TLE);
+        case '+':
+            if (at(pos + 1) == '+') {
+                pos += 2;
+                return done(TInc);
+            }
+            return pair('=', TPlus, TPlusEq);
+        case '-':
+            if (at(pos + 1) == '-') {
+                pos += 2;
+                return done(TDec);
+            }
+            return pair('=', TMinus, TMinusEq);
+        case '!':
+            pos++;
+            if (at(pos) == '=') {
+                pos++;
+                return done(TNotEq);
+            }
+            lx.error = "ожидался символ '='";
+            return done(Terr);
+        default:
+            pos++;
+            lx.error = "недопустимый символ";
+            return done(Terr);
+    }
+}
+
 class Scanner {
 public:
     explicit Scanner(const std::string& filename);
@@ -26,16 +143,6 @@ public:
     std::string getCurrentLineText() const;
 
 private:
-    const std::unordered_map<std::string, uint16_t> keywords{
-        {"int", TInt},
-        {"double", TDouble},
-        {"void", TVoid},
-        {"class", TClass},
-        {"while", TWhile},
-        {"return", TReturn},
-        {"main", TMain}
-    };
-
     std::string programText;
     uint32_t pos = 0;
     uint32_t currentLine = 1;
@@ -45,9 +152,5 @@ private:
     void getTextFromFile(const std::string& filename);
     void buildLineIndex();
 
-    bool isDigit(const char& ch);
-    bool isLetter(const char& ch);
-    bool isKeyword(const std::string& token);
-
     void printError(const std::string& error, const std::string& token);
 };
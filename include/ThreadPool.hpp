@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Потоки создаются один раз и ждут задания; parallelFor делит 0..count
+// на size() частей, первую выполняет вызывающий поток, и возвращается,
+// когда готовы все части.
+class ThreadPool {
+public:
+    using Task = std::function<void(uint32_t begin, uint32_t end)>;
+
+    explicit ThreadPool(unsigned threads);  // вместе с вызывающим потоком
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    void parallelFor(uint32_t count, const Task& fn);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+
+    const Task* task = nullptr;
+    uint32_t count = 0;
+    uint32_t chunk = 0;
+    uint64_t generation = 0;    // растёт с каждым заданием
+    unsigned pending = 0;       // части задания, которые ещё выполняются
+    bool stopping = false;
+
+    void workLoop(unsigned part);
+    void runPart(unsigned part) const;
+};
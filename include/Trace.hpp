@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+// Уровень отладочной печати интерпретатора выбирается при сборке
+// (-DTRACE_LEVEL=off|events|ops в CMake): events - строки [DEBUG] о while,
+// методах и return, ops - ещё и каждая операция, шаг и результат выражения.
+// Проверки - if constexpr, при off печать и её аргументы не компилируются.
+enum class TraceLevel : uint8_t { Off, Events, Ops };
+
+#ifndef TRANSLATOR_TRACE
+#define TRANSLATOR_TRACE 2
+#endif
+
+inline constexpr TraceLevel traceLevel = static_cast<TraceLevel>(TRANSLATOR_TRACE);
+
+template <TraceLevel Level>
+inline constexpr bool traces = traceLevel >= Level;
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <bit>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
-enum TypeObject {
+enum TypeObject : uint8_t {
     ObjEmpty = 0,
     ObjVar,
     ObjConst,
@@ -14,46 +18,110 @@ enum TypeObject {
     ObjField
 };
 
-enum PrimitiveDataType {
+enum PrimitiveDataType : uint8_t {
     UndefinedType = 0,
     IntType,
     DoubleType
 };
 
-enum DataType {
+enum DataType : uint8_t {
     TYPE_UNKNOWN = 0,
     TYPE_INT,
     TYPE_DOUBLE
 };
 
-union DataValue {
-    int dataAsInt;
-    double dataAsDouble;
-    DataValue() : dataAsInt(0) {}
+// Значение в 8 байтах (NaN-boxing). double хранится как есть; int и
+// неопределённое значение (номер блока объекта) - в младших 32 битах под
+// тегом в старших 16. Теги заняты отрицательными NaN, вычисленный NaN
+// с таким префиксом приводится к обычному -nan.
+class TData {
+public:
+    constexpr TData() : bits(UnknownTag << 48) {}
+
+    static constexpr TData Int(int v) { return TData((IntTag << 48) | static_cast<uint32_t>(v)); }
+    static constexpr TData Double(double v) {
+        uint64_t b = std::bit_cast<uint64_t>(v);
+        return TData((b >> 48) >= IntTag ? CanonicalNaN : b);
+    }
+    static constexpr TData Unknown(int v) { return TData((UnknownTag << 48) | static_cast<uint32_t>(v)); }
+
+    constexpr DataType type() const {
+        const uint64_t tag = bits >> 48;
+        return tag == IntTag ? TYPE_INT : (tag == UnknownTag ? TYPE_UNKNOWN : TYPE_DOUBLE);
+    }
+    constexpr bool isInt() const { return (bits >> 48) == IntTag; }
+    constexpr bool isDouble() const { return (bits >> 48) < IntTag; }
+    constexpr bool isUnknown() const { return (bits >> 48) == UnknownTag; }
+
+    // чтение не своего типа видит те же биты, что и прежнее объединение int/double
+    constexpr int asInt() const { return static_cast<int>(static_cast<uint32_t>(bits)); }
+    constexpr double asDouble() const {
+        return std::bit_cast<double>(isDouble() ? bits : (bits & UINT32_MAX));
+    }
+
+    // смена тега без преобразования значения
+    constexpr void retag(DataType t) {
+        if (t == TYPE_DOUBLE) *this = Double(asDouble());
+        else if (t == TYPE_INT) *this = Int(asInt());
+        else *this = Unknown(asInt());
+    }
+
+    constexpr uint64_t raw() const { return bits; }
+
+private:
+    static constexpr uint64_t IntTag = 0xFFFC;
+    static constexpr uint64_t UnknownTag = 0xFFFD;
+    static constexpr uint64_t CanonicalNaN = 0xFFF8000000000000ull;
+
+    constexpr explicit TData(uint64_t b) : bits(b) {}
+
+    uint64_t bits;
 };
 
-struct TData {
-    DataType dataType;
-    DataValue dataValue;
-    TData() : dataType(TYPE_UNKNOWN), dataValue() {}
+static_assert(sizeof(TData) == 8);
+
+// Таблица имён: каждая строка хранится один раз, узлы держат её номер.
+// Номер 0 зарезервирован за пустой строкой.
+class NameTable {
+public:
+    static constexpr uint32_t NoName = UINT32_MAX;
+
+    static uint32_t Intern(const std::string& name);
+    static uint32_t Find(const std::string& name);
+    static const std::string& Get(uint32_t nameId) { return names[nameId]; }
+    static uint32_t Size() { return static_cast<uint32_t>(names.size()); }
+
+private:
+    static std::vector<std::string> names;
+    static std::unordered_map<std::string, uint32_t> ids;
 };
 
 struct Node {
-    std::string id;
+    static constexpr uint32_t NoSlot = UINT32_MAX;
+
+    uint32_t nameId;
+    uint32_t typeNameId;
+
     TypeObject objType;
     PrimitiveDataType datType;
-
     bool isInitialized;
-    std::string typeName;
+
+    // ObjField - смещение в блоке объекта, ObjClass - номер раскладки полей,
+    // ObjVar - ячейка в кадре функции (у глобальных NoSlot),
+    // ObjMethod/ObjFunc - размер кадра.
+    // Переменная объектного типа хранит номер блока экземпляра в data,
+    // метод - позицию начала тела (TData::Int).
+    uint32_t slot;
 
     TData data;
 
     Node()
-        : id(),
+        : nameId(0),
+          typeNameId(0),
           objType(ObjEmpty),
           datType(UndefinedType),
           isInitialized(false),
-          typeName(),
+          slot(NoSlot),
           data() {}
 
     Node(const std::string& i,
@@ -61,32 +129,37 @@ struct Node {
          PrimitiveDataType d = UndefinedType,
          bool init = false,
          const std::string& tn = std::string())
-        : id(i),
+        : nameId(NameTable::Intern(i)),
+          typeNameId(tn.empty() ? 0 : NameTable::Intern(tn)),
           objType(o),
           datType(d),
           isInitialized(init),
-          typeName(tn),
+          slot(NoSlot),
           data() {
         switch (datType) {
             case IntType:
-                data.dataType = TYPE_INT;
-                data.dataValue.dataAsInt = 0;
+                data = TData::Int(0);
                 break;
             case DoubleType:
-                data.dataType = TYPE_DOUBLE;
-                data.dataValue.dataAsDouble = 0.0;
+                data = TData::Double(0.0);
                 break;
             default:
-                data.dataType = TYPE_UNKNOWN;
                 break;
         }
     }
+
+    const std::string& id() const { return NameTable::Get(nameId); }
+    const std::string& typeName() const { return NameTable::Get(typeNameId); }
+    bool hasTypeName() const { return typeNameId != 0; }
 };
 
+// Узлы дерева лежат в общем хранилище блоками по ChunkSize штук (адреса
+// стабильны), связи между ними - 32-битные номера, имя - номер в NameTable.
+// Дети узла хранятся в непрерывных массивах: объявления отдельно от
+// вложенных областей [Scope], поиск по имени идёт только по объявлениям.
 class Tree {
 public:
-    Tree(Node* data = nullptr, Tree* parent = nullptr);
-    ~Tree();
+    static constexpr uint32_t NoIndex = UINT32_MAX;
 
     static void setCurrent(Tree* cur);
     static Tree* getCurrent();
@@ -110,17 +183,49 @@ public:
     static std::string TypeName(PrimitiveDataType t);
     static std::string ObjName(TypeObject o);
 
-    Node* getNode() { return node.get(); }
-    Tree* getParent() { return parent; }
-    Tree* getLeft() { return firstChild; }
-    Tree* getRight() { return nextSibling; }
+    Node* getNode() { return &node; }
+    Tree* getParent() { return At(parent); }
 
 private:
-    std::unique_ptr<Node> node;
+    struct ChildRef {
+        uint32_t nameId;
+        uint32_t index;
+    };
+
+    // вложенная область и число объявлений, добавленных до неё (для печати)
+    struct ScopeRef {
+        uint32_t declCount;
+        uint32_t index;
+    };
+
+    struct ChildList {
+        std::vector<ChildRef> decls;
+        std::vector<ScopeRef> scopes;
+    };
+
+    Node node;
+
+    uint32_t self;
+    uint32_t parent;
+    uint32_t children;   // номер в childLists или NoIndex
+
+    Tree();
+
+    static constexpr uint32_t ChunkBits = 12;
+    static constexpr uint32_t ChunkSize = 1u << ChunkBits;
+
+    static std::vector<std::unique_ptr<Tree[]>> chunks;
+    static uint32_t count;
+
+    static std::vector<ChildList> childLists;
+
+    static Tree* At(uint32_t index) {
+        if (index == NoIndex) return nullptr;
+        return &chunks[index >> ChunkBits][index & (ChunkSize - 1)];
+    }
+    static Tree* Alloc(const Node& data, Tree* parent);
 
-    Tree* parent;
-    Tree* firstChild;
-    Tree* nextSibling;
+    const ChildRef* findChild(uint32_t nameId) const;
 
     static Tree* root;
     static Tree* current;
@@ -0,0 +1,1295 @@
+#include "CodeGen.hpp"
+
+#include <bit>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include "Expr.hpp"
+
+namespace {
+
+// Поддержка выполнения без libc: вывод буферизуется и пишется системным
+// вызовом write, double печатается как std::cout (%g, 6 значащих цифр)
+// точным делением больших чисел. Все функции сохраняют регистры, кроме
+// описанных, xmm-регистры не трогают.
+const char* const Runtime = R"asm(
+# ---- поддержка выполнения ----
+    .text
+
+# rdi = fd, rsi = адрес, rdx = длина; портит rax, rcx, r11, rsi, rdx
+rt_write:
+.Lrt_write1:
+    test rdx, rdx
+    jz .Lrt_write2
+    mov eax, 1
+    syscall
+    test rax, rax
+    jle .Lrt_write2
+    add rsi, rax
+    sub rdx, rax
+    jmp .Lrt_write1
+.Lrt_write2:
+    ret
+
+rt_flush:
+    push rax
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push r11
+    mov edi, 1
+    lea rsi, [rip+rt_out]
+    mov rdx, QWORD PTR [rip+rt_outLen]
+    call rt_write
+    mov QWORD PTR [rip+rt_outLen], 0
+    pop r11
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rax
+    ret
+
+# rsi = адрес, rdx = длина
+rt_put:
+    push rax
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    lea rdi, [rip+rt_out]
+.Lrt_put1:
+    test rdx, rdx
+    jz .Lrt_put3
+    mov rcx, QWORD PTR [rip+rt_outLen]
+    cmp rcx, 65536
+    jb .Lrt_put2
+    call rt_flush
+    xor ecx, ecx
+.Lrt_put2:
+    mov al, BYTE PTR [rsi]
+    mov BYTE PTR [rdi+rcx], al
+    inc rcx
+    mov QWORD PTR [rip+rt_outLen], rcx
+    inc rsi
+    dec rdx
+    jmp .Lrt_put1
+.Lrt_put3:
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rax
+    ret
+
+# rdi = строка с нулём
+rt_puts:
+    push rsi
+    push rdx
+    mov rsi, rdi
+    xor edx, edx
+.Lrt_puts1:
+    cmp BYTE PTR [rdi+rdx], 0
+    je .Lrt_puts2
+    inc rdx
+    jmp .Lrt_puts1
+.Lrt_puts2:
+    call rt_put
+    pop rdx
+    pop rsi
+    ret
+
+# eax = число
+rt_putInt:
+    push rax
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    sub rsp, 16
+    movsxd rax, eax
+    lea rdi, [rsp+16]
+    mov rsi, rax
+    test rax, rax
+    jns .Lrt_putInt1
+    neg rax
+.Lrt_putInt1:
+    mov ecx, 10
+.Lrt_putInt2:
+    xor edx, edx
+    div rcx
+    add dl, 48
+    dec rdi
+    mov BYTE PTR [rdi], dl
+    test rax, rax
+    jnz .Lrt_putInt2
+    test rsi, rsi
+    jns .Lrt_putInt3
+    dec rdi
+    mov BYTE PTR [rdi], 45
+.Lrt_putInt3:
+    lea rdx, [rsp+16]
+    sub rdx, rdi
+    mov rsi, rdi
+    call rt_put
+    add rsp, 16
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rax
+    ret
+
+# Большие числа: 40 32-битных слов от младшего, хватает на 2^1074 * 10^324.
+# rdi = число; портят rax, rcx, r8, r9
+
+# rdi = rax
+rt_bnSet:
+    xor ecx, ecx
+.Lrt_bnSet1:
+    mov DWORD PTR [rdi+rcx*4], 0
+    inc rcx
+    cmp rcx, 40
+    jb .Lrt_bnSet1
+    mov DWORD PTR [rdi], eax
+    shr rax, 32
+    mov DWORD PTR [rdi+4], eax
+    ret
+
+# rdi = rsi
+rt_bnCopy:
+    xor ecx, ecx
+.Lrt_bnCopy1:
+    mov eax, DWORD PTR [rsi+rcx*4]
+    mov DWORD PTR [rdi+rcx*4], eax
+    inc rcx
+    cmp rcx, 40
+    jb .Lrt_bnCopy1
+    ret
+
+# rdi *= esi
+rt_bnMul:
+    xor r8d, r8d
+    xor ecx, ecx
+    mov r9d, esi
+.Lrt_bnMul1:
+    mov eax, DWORD PTR [rdi+rcx*4]
+    imul rax, r9
+    add rax, r8
+    mov DWORD PTR [rdi+rcx*4], eax
+    shr rax, 32
+    mov r8, rax
+    inc rcx
+    cmp rcx, 40
+    jb .Lrt_bnMul1
+    ret
+
+# rdi -= rsi (rdi >= rsi)
+rt_bnSub:
+    xor ecx, ecx
+    mov r8d, 40
+    clc
+.Lrt_bnSub1:
+    mov eax, DWORD PTR [rsi+rcx*4]
+    sbb DWORD PTR [rdi+rcx*4], eax
+    lea rcx, [rcx+1]
+    dec r8
+    jnz .Lrt_bnSub1
+    ret
+
+# eax = знак (rdi - rsi)
+rt_bnCmp:
+    mov ecx, 39
+.Lrt_bnCmp1:
+    mov eax, DWORD PTR [rdi+rcx*4]
+    cmp eax, DWORD PTR [rsi+rcx*4]
+    ja .Lrt_bnCmpGt
+    jb .Lrt_bnCmpLt
+    sub rcx, 1
+    jnc .Lrt_bnCmp1
+    xor eax, eax
+    ret
+.Lrt_bnCmpGt:
+    mov eax, 1
+    ret
+.Lrt_bnCmpLt:
+    mov eax, -1
+    ret
+
+# rdi *= 2^rsi; портит r10
+rt_bnPow2:
+    push rsi
+    mov r10, rsi
+.Lrt_bnPow2a:
+    cmp r10, 31
+    jb .Lrt_bnPow2b
+    mov esi, 0x80000000
+    call rt_bnMul
+    sub r10, 31
+    jmp .Lrt_bnPow2a
+.Lrt_bnPow2b:
+    mov ecx, r10d
+    mov esi, 1
+    shl esi, cl
+    call rt_bnMul
+    pop rsi
+    ret
+
+# rdi *= 10^rsi; портит r10
+rt_bnPow10:
+    push rsi
+    mov r10, rsi
+.Lrt_bnPow10a:
+    cmp r10, 9
+    jb .Lrt_bnPow10b
+    mov esi, 1000000000
+    call rt_bnMul
+    sub r10, 9
+    jmp .Lrt_bnPow10a
+.Lrt_bnPow10b:
+    test r10, r10
+    jz .Lrt_bnPow10c
+    mov esi, 10
+    call rt_bnMul
+    dec r10
+    jmp .Lrt_bnPow10b
+.Lrt_bnPow10c:
+    pop rsi
+    ret
+
+# xmm0 = число. v = f * 2^e = R / S; S масштабируется так, что
+# S <= R < 10 S, затем шесть цифр делением и округление к чётному.
+rt_putDouble:
+    push rax
+    push rbx
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push r8
+    push r9
+    push r10
+    push r11
+    push r12
+    push r13
+    push r14
+    sub rsp, 32
+    mov r14, rsp
+    movq rbx, xmm0
+    test rbx, rbx
+    jns .Lrt_pd1
+    mov BYTE PTR [r14], 45
+    inc r14
+.Lrt_pd1:
+    mov rax, rbx
+    shr rax, 52
+    and eax, 0x7FF
+    mov rcx, 0xFFFFFFFFFFFFF
+    and rbx, rcx
+    cmp eax, 0x7FF
+    jne .Lrt_pd3
+    lea rsi, [rip+rt_strInf]
+    test rbx, rbx
+    jz .Lrt_pd2
+    lea rsi, [rip+rt_strNan]
+.Lrt_pd2:
+    mov al, BYTE PTR [rsi]
+    mov BYTE PTR [r14], al
+    mov al, BYTE PTR [rsi+1]
+    mov BYTE PTR [r14+1], al
+    mov al, BYTE PTR [rsi+2]
+    mov BYTE PTR [r14+2], al
+    add r14, 3
+    jmp .Lrt_pdDone
+.Lrt_pd3:
+    test eax, eax
+    jnz .Lrt_pd5
+    test rbx, rbx
+    jnz .Lrt_pd4
+    mov BYTE PTR [r14], 48
+    inc r14
+    jmp .Lrt_pdDone
+.Lrt_pd4:
+    mov r12, -1074
+    jmp .Lrt_pd6
+.Lrt_pd5:
+    bts rbx, 52
+    lea r12, [rax-1075]
+.Lrt_pd6:
+    # k = floor(log10(2^p)), p = e + номер старшего бита f: 10^k <= v < 10^(k+2)
+    bsr rcx, rbx
+    lea rax, [r12+rcx]
+    test rax, rax
+    js .Lrt_pd7
+    imul rax, rax, 78913
+    sar rax, 18
+    jmp .Lrt_pd8
+.Lrt_pd7:
+    neg rax
+    imul rax, rax, 78913
+    sar rax, 18
+    inc rax
+    neg rax
+.Lrt_pd8:
+    mov r13, rax
+    lea rdi, [rip+rt_bnR]
+    mov rax, rbx
+    call rt_bnSet
+    lea rdi, [rip+rt_bnS]
+    mov eax, 1
+    call rt_bnSet
+    mov rsi, r12
+    lea rdi, [rip+rt_bnR]
+    test rsi, rsi
+    jns .Lrt_pd9
+    neg rsi
+    lea rdi, [rip+rt_bnS]
+.Lrt_pd9:
+    call rt_bnPow2
+    mov rsi, r13
+    lea rdi, [rip+rt_bnS]
+    test rsi, rsi
+    jns .Lrt_pd10
+    neg rsi
+    lea rdi, [rip+rt_bnR]
+.Lrt_pd10:
+    call rt_bnPow10
+    lea rdi, [rip+rt_bnT]
+    lea rsi, [rip+rt_bnS]
+    call rt_bnCopy
+    mov esi, 10
+    call rt_bnMul
+    lea rdi, [rip+rt_bnR]
+    lea rsi, [rip+rt_bnT]
+    call rt_bnCmp
+    test eax, eax
+    js .Lrt_pd11
+    inc r13
+    lea rdi, [rip+rt_bnS]
+    lea rsi, [rip+rt_bnT]
+    call rt_bnCopy
+.Lrt_pd11:
+    xor r12d, r12d
+    lea rdi, [rip+rt_bnR]
+    lea rsi, [rip+rt_bnS]
+.Lrt_pdDigit:
+    xor ebx, ebx
+.Lrt_pdDigit1:
+    call rt_bnCmp
+    test eax, eax
+    js .Lrt_pdDigit2
+    call rt_bnSub
+    inc ebx
+    jmp .Lrt_pdDigit1
+.Lrt_pdDigit2:
+    lea rax, [rip+rt_digits]
+    mov BYTE PTR [rax+r12], bl
+    inc r12
+    cmp r12, 6
+    je .Lrt_pdRound
+    push rsi
+    mov esi, 10
+    call rt_bnMul
+    pop rsi
+    jmp .Lrt_pdDigit
+.Lrt_pdRound:
+    push rsi
+    mov esi, 2
+    call rt_bnMul
+    pop rsi
+    call rt_bnCmp
+    lea rsi, [rip+rt_digits]
+    test eax, eax
+    js .Lrt_pdFormat
+    jnz .Lrt_pdUp
+    test BYTE PTR [rsi+5], 1
+    jz .Lrt_pdFormat
+.Lrt_pdUp:
+    mov ecx, 5
+.Lrt_pdUp1:
+    inc BYTE PTR [rsi+rcx]
+    cmp BYTE PTR [rsi+rcx], 10
+    jne .Lrt_pdFormat
+    mov BYTE PTR [rsi+rcx], 0
+    dec rcx
+    jns .Lrt_pdUp1
+    mov BYTE PTR [rsi], 1
+    inc r13
+.Lrt_pdFormat:
+    # r13 - десятичный порядок X, r12 - цифр без хвостовых нулей
+    mov r12d, 6
+.Lrt_pdTrim:
+    cmp BYTE PTR [rsi+r12-1], 0
+    jne .Lrt_pdTrim1
+    dec r12
+    jmp .Lrt_pdTrim
+.Lrt_pdTrim1:
+    cmp r13, -4
+    jl .Lrt_pdSci
+    cmp r13, 6
+    jge .Lrt_pdSci
+    test r13, r13
+    js .Lrt_pdSmall
+    xor ecx, ecx
+.Lrt_pdInt:
+    mov al, BYTE PTR [rsi+rcx]
+    add al, 48
+    mov BYTE PTR [r14], al
+    inc r14
+    inc rcx
+    cmp rcx, r13
+    jle .Lrt_pdInt
+    cmp rcx, r12
+    jge .Lrt_pdDone
+    mov BYTE PTR [r14], 46
+    inc r14
+.Lrt_pdFrac:
+    mov al, BYTE PTR [rsi+rcx]
+    add al, 48
+    mov BYTE PTR [r14], al
+    inc r14
+    inc rcx
+    cmp rcx, r12
+    jl .Lrt_pdFrac
+    jmp .Lrt_pdDone
+.Lrt_pdSmall:
+    mov BYTE PTR [r14], 48
+    mov BYTE PTR [r14+1], 46
+    add r14, 2
+    mov rcx, r13
+    not rcx
+.Lrt_pdSmall1:
+    test rcx, rcx
+    jz .Lrt_pdSmall2
+    mov BYTE PTR [r14], 48
+    inc r14
+    dec rcx
+    jmp .Lrt_pdSmall1
+.Lrt_pdSmall2:
+    xor ecx, ecx
+    jmp .Lrt_pdFrac
+.Lrt_pdSci:
+    mov al, BYTE PTR [rsi]
+    add al, 48
+    mov BYTE PTR [r14], al
+    inc r14
+    mov ecx, 1
+    cmp rcx, r12
+    jge .Lrt_pdExp
+    mov BYTE PTR [r14], 46
+    inc r14
+.Lrt_pdSci1:
+    mov al, BYTE PTR [rsi+rcx]
+    add al, 48
+    mov BYTE PTR [r14], al
+    inc r14
+    inc rcx
+    cmp rcx, r12
+    jl .Lrt_pdSci1
+.Lrt_pdExp:
+    mov BYTE PTR [r14], 101
+    mov BYTE PTR [r14+1], 43
+    mov rax, r13
+    test rax, rax
+    jns .Lrt_pdExp1
+    mov BYTE PTR [r14+1], 45
+    neg rax
+.Lrt_pdExp1:
+    add r14, 2
+    cmp rax, 100
+    jb .Lrt_pdExp2
+    xor edx, edx
+    mov ecx, 100
+    div rcx
+    add al, 48
+    mov BYTE PTR [r14], al
+    inc r14
+    mov rax, rdx
+.Lrt_pdExp2:
+    xor edx, edx
+    mov ecx, 10
+    div rcx
+    add al, 48
+    mov BYTE PTR [r14], al
+    add dl, 48
+    mov BYTE PTR [r14+1], dl
+    add r14, 2
+.Lrt_pdDone:
+    mov rsi, rsp
+    mov rdx, r14
+    sub rdx, rsp
+    call rt_put
+    add rsp, 32
+    pop r14
+    pop r13
+    pop r12
+    pop r11
+    pop r10
+    pop r9
+    pop r8
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rbx
+    pop rax
+    ret
+
+# печать присваивания: rdi = имя, значение в eax / xmm0
+rt_printInt:
+    push rsi
+    push rdx
+    call rt_puts
+    lea rsi, [rip+rt_strEq]
+    mov edx, 3
+    call rt_put
+    call rt_putInt
+    lea rsi, [rip+rt_strNl]
+    mov edx, 1
+    call rt_put
+    pop rdx
+    pop rsi
+    ret
+
+rt_printDouble:
+    push rsi
+    push rdx
+    call rt_puts
+    lea rsi, [rip+rt_strEq]
+    mov edx, 3
+    call rt_put
+    call rt_putDouble
+    lea rsi, [rip+rt_strNl]
+    mov edx, 1
+    call rt_put
+    pop rdx
+    pop rsi
+    ret
+
+# сообщение о приведении: rdi = имя
+rt_noticeD2I:
+    push rdi
+    lea rdi, [rip+rt_strD2I]
+    jmp .Lrt_notice
+rt_noticeI2D:
+    push rdi
+    lea rdi, [rip+rt_strI2D]
+.Lrt_notice:
+    call rt_puts
+    pop rdi
+    call rt_puts
+    push rdi
+    lea rdi, [rip+rt_strQuote]
+    call rt_puts
+    pop rdi
+    ret
+
+# предупреждение в stderr: rdi = текст
+rt_warn:
+    push rax
+    push rcx
+    push rdx
+    push rsi
+    push rdi
+    push r11
+    call rt_flush
+    mov rsi, rdi
+    xor edx, edx
+.Lrt_warn1:
+    cmp BYTE PTR [rdi+rdx], 0
+    je .Lrt_warn2
+    inc rdx
+    jmp .Lrt_warn1
+.Lrt_warn2:
+    mov edi, 2
+    call rt_write
+    mov edi, 2
+    lea rsi, [rip+rt_strNl]
+    mov edx, 1
+    call rt_write
+    pop r11
+    pop rdi
+    pop rsi
+    pop rdx
+    pop rcx
+    pop rax
+    ret
+
+rt_exit:
+    call rt_flush
+    xor edi, edi
+    mov eax, 231
+    syscall
+
+    .section .rodata
+    .align 8
+rt_one:
+    .quad 0x3FF0000000000000
+rt_strEq:
+    .ascii " = "
+rt_strNl:
+    .ascii "\n"
+rt_strInf:
+    .ascii "inf"
+rt_strNan:
+    .ascii "nan"
+rt_strQuote:
+    .asciz "'\n"
+rt_msgDivInt:
+    .asciz "Warning: division by zero (int)"
+rt_msgModInt:
+    .asciz "Warning: modulo by zero"
+rt_msgDivDouble:
+    .asciz "Warning: division by zero (double)"
+rt_msgModDouble:
+    .asciz "Warning: operator % for double, casting to int"
+)asm";
+
+// отдельно: строки с кириллицей пишутся восьмеричными кодами
+const char* const NoticeD2I = "приведение типа (double -> int) при присваивании '";
+const char* const NoticeI2D = "приведение типа (int -> double) при присваивании '";
+
+const char* const RuntimeData = R"asm(
+    .bss
+    .align 8
+rt_outLen:
+    .zero 8
+rt_out:
+    .zero 65536
+rt_bnR:
+    .zero 160
+rt_bnS:
+    .zero 160
+rt_bnT:
+    .zero 160
+rt_digits:
+    .zero 8
+
+    .section .note.GNU-stack,"",@progbits
+)asm";
+
+std::string asciz(const std::string& s) {
+    std::string r = "\"";
+    for (unsigned char c : s) {
+        if (c < 0x20 || c >= 0x7F || c == '"' || c == '\\') {
+            char buf[8];
+            std::snprintf(buf, sizeof buf, "\\%03o", c);
+            r += buf;
+        } else {
+            r += static_cast<char>(c);
+        }
+    }
+    return r + "\"";
+}
+
+// Раскладка объекта: каждое поле - 8 байт, поля-объекты развёрнуты на месте.
+struct Member {
+    uint32_t offset = 0;
+    PrimitiveDataType type = UndefinedType;
+    std::string className;
+    bool method = false;
+};
+
+struct Layout {
+    uint32_t size = 0;
+    std::unordered_map<std::string, Member> members;
+};
+
+// переменная: локальная (смещение от rbp) или глобальная
+struct Var {
+    int32_t offset = 0;
+    PrimitiveDataType type = UndefinedType;
+    std::string className;
+};
+
+// адрес значения designator'а: base + disp; у вызова - адрес получателя
+struct Place {
+    std::string base;
+    int64_t disp = 0;
+    PrimitiveDataType type = UndefinedType;
+    std::string className;
+    std::string method;
+};
+
+// Код стековой машины: int-результат в eax, double - в xmm0, левый
+// операнд бинарной операции ждёт на стеке, пока вычисляется правый.
+class AsmWriter {
+public:
+    explicit AsmWriter(std::ostream& out) : out(out) {}
+
+    void program(const AstProgram& program);
+
+private:
+    std::ostream& out;
+    std::ostringstream code;
+
+    std::unordered_map<std::string, Layout> layouts;
+    std::unordered_map<std::string, Var> globals;
+    std::vector<std::unordered_map<std::string, Var>> scopes;
+    std::string currentClass;
+    std::string currentMethod;
+    PrimitiveDataType returnType = IntType;
+    std::string returnLabel;
+    uint32_t frameSize = 0;
+    uint32_t labels = 0;
+    bool quiet = false;
+
+    std::map<std::string, std::string> strings;
+    std::map<uint64_t, std::string> doubles;
+
+    void emit(const std::string& text) { code << "    " << text << "\n"; }
+    void place(const std::string& label) { code << label << ":\n"; }
+    std::string label() { return ".L" + std::to_string(labels++); }
+    std::string str(const std::string& s);
+    std::string constant(double v);
+
+    static std::string mem(const Place& p, const char* size);
+    Place resolve(const AstDesignator& d);
+    Var allocate(uint32_t slots);
+
+    void load(const Place& p);
+    void store(const Place& p);
+    void widen(PrimitiveDataType from, PrimitiveDataType to);
+    void convert(PrimitiveDataType from, PrimitiveDataType to, const std::string& decl);
+    void print(const std::string& name, PrimitiveDataType t);
+    void call(const Place& p);
+    void step(PrimitiveDataType t, uint16_t op);
+    void operation(uint16_t op, PrimitiveDataType common);
+    void expr(const AstExpr& e);
+
+    void statements(const std::vector<AstStmt>& body);
+    void statement(const AstStmt& s);
+    void function(const std::string& name, const std::vector<AstStmt>& body, bool isMain);
+};
+
+std::string AsmWriter::str(const std::string& s) {
+    auto it = strings.find(s);
+    if (it == strings.end()) {
+        it = strings.emplace(s, ".LS" + std::to_string(strings.size())).first;
+    }
+    return it->second;
+}
+
+std::string AsmWriter::constant(double v) {
+    uint64_t bits = std::bit_cast<uint64_t>(v);
+    auto it = doubles.find(bits);
+    if (it == doubles.end()) {
+        it = doubles.emplace(bits, ".LD" + std::to_string(doubles.size())).first;
+    }
+    return it->second;
+}
+
+std::string AsmWriter::mem(const Place& p, const char* size) {
+    std::string r = std::string(size) + " PTR [" + p.base;
+    if (p.disp > 0) r += "+" + std::to_string(p.disp);
+    if (p.disp < 0) r += std::to_string(p.disp);
+    return r + "]";
+}
+
+Var AsmWriter::allocate(uint32_t slots) {
+    frameSize += 8 * slots;
+    Var v;
+    v.offset = -static_cast<int32_t>(frameSize);
+    return v;
+}
+
+// поле и метод текущего объекта адресуются от this, загруженного в r8
+Place AsmWriter::resolve(const AstDesignator& d) {
+    Place p;
+    const std::string& root = d.path[0];
+
+    switch (d.root) {
+        case AstDesignator::Local: {
+            for (auto scope = scopes.rbegin(); scope != scopes.rend(); ++scope) {
+                auto it = scope->find(root);
+                if (it != scope->end()) {
+                    p.base = "rbp";
+                    p.disp = it->second.offset;
+                    p.type = it->second.type;
+                    p.className = it->second.className;
+                    break;
+                }
+            }
+            break;
+        }
+        case AstDesignator::Global: {
+            const Var& g = globals.at(root);
+            p.base = "rip+u." + root;
+            p.type = g.type;
+            p.className = g.className;
+            break;
+        }
+        case AstDesignator::Field: {
+            emit("mov r8, QWORD PTR [rbp-8]");
+            const Member& m = layouts.at(currentClass).members.at(root);
+            p.base = "r8";
+            p.disp = 8 * static_cast<int64_t>(m.offset);
+            p.type = m.type;
+            p.className = m.className;
+            break;
+        }
+        case AstDesignator::Method:
+            emit("mov r8, QWORD PTR [rbp-8]");
+            p.base = "r8";
+            p.className = currentClass;
+            p.method = root;
+            break;
+    }
+
+    for (size_t i = 1; i < d.path.size(); ++i) {
+        const Member& m = layouts.at(p.className).members.at(d.path[i]);
+        if (m.method) {
+            p.method = d.path[i];
+            break;
+        }
+        p.disp += 8 * static_cast<int64_t>(m.offset);
+        p.type = m.type;
+        p.className = m.className;
+    }
+    return p;
+}
+
+void AsmWriter::load(const Place& p) {
+    if (p.type == DoubleType) emit("movsd xmm0, " + mem(p, "QWORD"));
+    else emit("mov eax, " + mem(p, "DWORD"));
+}
+
+void AsmWriter::store(const Place& p) {
+    if (p.type == DoubleType) emit("movsd " + mem(p, "QWORD") + ", xmm0");
+    else emit("mov " + mem(p, "DWORD") + ", eax");
+}
+
+// операнд int в double-операции
+void AsmWriter::widen(PrimitiveDataType from, PrimitiveDataType to) {
+    if (from == IntType && to == DoubleType) emit("cvtsi2sd xmm0, eax");
+}
+
+// присваивание значения другого типа - с сообщением, как в assignValue
+void AsmWriter::convert(PrimitiveDataType from, PrimitiveDataType to, const std::string& decl) {
+    if (to == IntType && from == DoubleType) {
+        emit("lea rdi, [rip+" + str(decl) + "]");
+        emit("call rt_noticeD2I");
+        emit("cvttsd2si eax, xmm0");
+    } else if (to == DoubleType && from == IntType) {
+        emit("lea rdi, [rip+" + str(decl) + "]");
+        emit("call rt_noticeI2D");
+        emit("cvtsi2sd xmm0, eax");
+    }
+}
+
+void AsmWriter::print(const std::string& name, PrimitiveDataType t) {
+    if (quiet) {
+        return;
+    }
+    emit("lea rdi, [rip+" + str(name) + "]");
+    emit(t == DoubleType ? "call rt_printDouble" : "call rt_printInt");
+}
+
+void AsmWriter::call(const Place& p) {
+    emit("lea rdi, [" + mem(p, "QWORD").substr(11));
+    emit("call u." + p.className + "." + p.method);
+}
+
+void AsmWriter::step(PrimitiveDataType t, uint16_t op) {
+    if (t == DoubleType) emit(op == TInc ? "addsd xmm0, QWORD PTR [rip+rt_one]" : "subsd xmm0, QWORD PTR [rip+rt_one]");
+    else emit(op == TInc ? "add eax, 1" : "sub eax, 1");
+}
+
+// левый операнд в eax / xmm0, правый в ecx / xmm1; результат на месте левого
+void AsmWriter::operation(uint16_t op, PrimitiveDataType common) {
+    if (isCompareOp(op)) {
+        if (common == IntType) {
+            emit("cmp eax, ecx");
+            const char* set = "";
+            switch (op) {
+                case TL:  set = "setl al";  break;
+                case TG:  set = "setg al";  break;
+                case TLE: set = "setle al"; break;
+                case TGE: set = "setge al"; break;
+                case TEq: set = "sete al";  break;
+                default:  set = "setne al"; break;
+            }
+            emit(set);
+        } else {
+            // NaN: всё ложно, кроме !=
+            switch (op) {
+                case TL:  emit("ucomisd xmm1, xmm0"); emit("seta al");  break;
+                case TG:  emit("ucomisd xmm0, xmm1"); emit("seta al");  break;
+                case TLE: emit("ucomisd xmm1, xmm0"); emit("setae al"); break;
+                case TGE: emit("ucomisd xmm0, xmm1"); emit("setae al"); break;
+                case TEq:
+                    emit("ucomisd xmm0, xmm1");
+                    emit("sete al");
+                    emit("setnp cl");
+                    emit("and al, cl");
+                    break;
+                default:
+                    emit("ucomisd xmm0, xmm1");
+                    emit("setne al");
+                    emit("setp cl");
+                    emit("or al, cl");
+                    break;
+            }
+        }
+        emit("movzx eax, al");
+        return;
+    }
+
+    if (common == IntType) {
+        switch (op) {
+            case TPlus:  emit("add eax, ecx");  return;
+            case TMinus: emit("sub eax, ecx");  return;
+            case TMult:  emit("imul eax, ecx"); return;
+            default: {
+                std::string ok = label(), done = label();
+                emit("test ecx, ecx");
+                emit("jnz " + ok);
+                emit(op == TDiv ? "lea rdi, [rip+rt_msgDivInt]" : "lea rdi, [rip+rt_msgModInt]");
+                emit("call rt_warn");
+                emit("xor eax, eax");
+                emit("jmp " + done);
+                place(ok);
+                // как wrapDiv/wrapMod: на -1 idiv переполняется для INT_MIN
+                std::string divide = label();
+                emit("cmp ecx, -1");
+                emit("jne " + divide);
+                emit(op == TDiv ? "neg eax" : "xor eax, eax");
+                emit("jmp " + done);
+                place(divide);
+                emit("cdq");
+                emit("idiv ecx");
+                if (op == TMod) emit("mov eax, edx");
+                place(done);
+                return;
+            }
+        }
+    }
+
+    switch (op) {
+        case TPlus:  emit("addsd xmm0, xmm1"); return;
+        case TMinus: emit("subsd xmm0, xmm1"); return;
+        case TMult:  emit("mulsd xmm0, xmm1"); return;
+        case TDiv: {
+            std::string ok = label(), done = label();
+            emit("pxor xmm2, xmm2");
+            emit("ucomisd xmm1, xmm2");
+            emit("jp " + ok);
+            emit("jne " + ok);
+            emit("lea rdi, [rip+rt_msgDivDouble]");
+            emit("call rt_warn");
+            emit("pxor xmm0, xmm0");
+            emit("jmp " + done);
+            place(ok);
+            emit("divsd xmm0, xmm1");
+            place(done);
+            return;
+        }
+        default:
+            // как doubleArith: static_cast<int> обоих операндов и int-остаток
+            emit("lea rdi, [rip+rt_msgModDouble]");
+            emit("call rt_warn");
+            emit("cvttsd2si eax, xmm0");
+            emit("cvttsd2si ecx, xmm1");
+            {
+                // остаток как wrapMod: делитель 0 или -1 даёт 0
+                std::string zero = label(), done = label();
+                emit("cmp ecx, -1");
+                emit("je " + zero);
+                emit("test ecx, ecx");
+                emit("je " + zero);
+                emit("cdq");
+                emit("idiv ecx");
+                emit("jmp " + done);
+                place(zero);
+                emit("xor edx, edx");
+                place(done);
+            }
+            emit("cvtsi2sd xmm0, edx");
+            return;
+    }
+}
+
+void AsmWriter::expr(const AstExpr& e) {
+    switch (e.kind) {
+        case AstExpr::Const:
+            if (e.type == DoubleType) emit("movsd xmm0, QWORD PTR [rip+" + constant(e.value.asDouble()) + "]");
+            else emit("mov eax, " + std::to_string(e.value.asInt()));
+            return;
+
+        case AstExpr::Var:
+            load(resolve(e.ref));
+            return;
+
+        case AstExpr::Call:
+            call(resolve(e.ref));
+            return;
+
+        case AstExpr::PreInc:
+        case AstExpr::PostInc: {
+            Place p = resolve(e.ref);
+            load(p);
+            if (e.kind == AstExpr::PostInc) {
+                emit(e.type == DoubleType ? "movapd xmm1, xmm0" : "mov ecx, eax");
+            }
+            step(e.type, e.op);
+            store(p);
+            if (e.kind == AstExpr::PostInc) {
+                emit(e.type == DoubleType ? "movapd xmm0, xmm1" : "mov eax, ecx");
+            }
+            return;
+        }
+
+        case AstExpr::Neg:
+            expr(*e.left);
+            if (e.type == DoubleType) {
+                emit("movq rax, xmm0");
+                emit("btc rax, 63");
+                emit("movq xmm0, rax");
+            } else {
+                emit("neg eax");
+            }
+            return;
+
+        case AstExpr::Binary: {
+            const PrimitiveDataType common =
+                (e.left->type == DoubleType || e.right->type == DoubleType) ? DoubleType : IntType;
+            expr(*e.left);
+            widen(e.left->type, common);
+            if (common == DoubleType) emit("movq rax, xmm0");
+            emit("push rax");
+            expr(*e.right);
+            widen(e.right->type, common);
+            emit(common == DoubleType ? "movapd xmm1, xmm0" : "mov ecx, eax");
+            emit("pop rax");
+            if (common == DoubleType) emit("movq xmm0, rax");
+            operation(e.op, common);
+            return;
+        }
+    }
+}
+
+void AsmWriter::statements(const std::vector<AstStmt>& body) {
+    for (const AstStmt& s : body) {
+        statement(s);
+    }
+}
+
+void AsmWriter::statement(const AstStmt& s) {
+    switch (s.kind) {
+        case AstStmt::Block:
+            scopes.emplace_back();
+            statements(s.body);
+            scopes.pop_back();
+            return;
+
+        case AstStmt::Decl: {
+            // инициализатор вычисляется до появления имени
+            if (s.expr) {
+                expr(*s.expr);
+                convert(s.expr->type, s.type, s.name);
+            }
+            Var v = allocate(1);
+            v.type = s.type;
+            scopes.back()[s.name] = v;
+
+            Place p;
+            p.base = "rbp";
+            p.disp = v.offset;
+            p.type = s.type;
+            if (!s.expr) {
+                emit("mov " + mem(p, "QWORD") + ", 0");
+                return;
+            }
+            store(p);
+            print(s.name, s.type);
+            return;
+        }
+
+        case AstStmt::ObjectDecl: {
+            const auto layout = layouts.find(s.className);
+            const uint32_t size = layout != layouts.end() ? layout->second.size : 0;
+            Var v = allocate(size);
+            v.className = s.className;
+            scopes.back()[s.name] = v;
+            for (uint32_t i = 0; i < size; ++i) {
+                emit("mov QWORD PTR [rbp" + std::to_string(v.offset + 8 * static_cast<int32_t>(i)) + "], 0");
+            }
+            return;
+        }
+
+        case AstStmt::Assign: {
+            expr(*s.expr);
+            PrimitiveDataType valueType = s.expr->type;
+            if (s.op != TEval) {
+                // текущее значение читается после правой части
+                const PrimitiveDataType common =
+                    (s.target.type == DoubleType || valueType == DoubleType) ? DoubleType : IntType;
+                widen(valueType, common);
+                emit(common == DoubleType ? "movapd xmm1, xmm0" : "mov ecx, eax");
+                Place p = resolve(s.target);
+                load(p);
+                widen(p.type, common);
+                operation(s.op, common);
+                valueType = common;
+                convert(valueType, p.type, s.target.declName());
+                store(p);
+            } else {
+                convert(valueType, s.target.type, s.target.declName());
+                store(resolve(s.target));
+            }
+            print(s.target.fullName(), s.target.type);
+            return;
+        }
+
+        case AstStmt::Step: {
+            Place p = resolve(s.target);
+            load(p);
+            step(p.type, s.op);
+            store(p);
+            print(s.target.fullName(), p.type);
+            return;
+        }
+
+        case AstStmt::Call:
+            call(resolve(s.target));
+            return;
+
+        case AstStmt::While: {
+            std::string cond = label(), body = label(), end = label();
+            place(cond);
+            expr(*s.expr);
+            if (s.expr->type == DoubleType) {
+                // выход, только если значение равно нулю (NaN - истина)
+                emit("pxor xmm1, xmm1");
+                emit("ucomisd xmm0, xmm1");
+                emit("jp " + body);
+                emit("je " + end);
+            } else {
+                emit("test eax, eax");
+                emit("je " + end);
+            }
+            place(body);
+            scopes.emplace_back();
+            statements(s.body);
+            scopes.pop_back();
+            emit("jmp " + cond);
+            place(end);
+            return;
+        }
+
+        case AstStmt::Return:
+            expr(*s.expr);
+            // результат приводится к типу метода, как при присваивании
+            if (returnType == IntType || returnType == DoubleType) {
+                convert(s.expr->type, returnType, currentMethod);
+            }
+            emit("jmp " + returnLabel);
+            return;
+    }
+}
+
+void AsmWriter::function(const std::string& name, const std::vector<AstStmt>& body, bool isMain) {
+    code.str("");
+    frameSize = 8;  // this
+    returnLabel = label();
+    scopes.assign(1, {});
+
+    if (!isMain) emit("mov QWORD PTR [rbp-8], rdi");
+    statements(body);
+    if (!isMain) {
+        // метод без return возвращает 0
+        emit(returnType == DoubleType ? "pxor xmm0, xmm0" : "xor eax, eax");
+    }
+    place(returnLabel);
+
+    out << "\n" << name << ":\n";
+    out << "    push rbp\n";
+    out << "    mov rbp, rsp\n";
+    out << "    sub rsp, " << ((frameSize + 15) & ~15u) << "\n";
+    out << code.str();
+    if (isMain) {
+        out << "    call rt_exit\n";
+    } else {
+        out << "    leave\n";
+        out << "    ret\n";
+    }
+}
+
+void AsmWriter::program(const AstProgram& program) {
+    quiet = program.quiet;
+    for (const AstClass& cls : program.classes) {
+        Layout& layout = layouts[cls.name];
+        for (const AstVar& f : cls.fields) {
+            Member m;
+            m.offset = layout.size;
+            m.type = f.type;
+            m.className = f.className;
+            layout.members[f.name] = m;
+            if (f.type != UndefinedType) {
+                layout.size += 1;
+            } else if (layouts.count(f.className)) {
+                layout.size += layouts[f.className].size;
+            }
+        }
+        for (const AstMethod& method : cls.methods) {
+            Member m;
+            m.type = method.type;
+            m.method = true;
+            layout.members[method.name] = m;
+        }
+    }
+    for (const AstVar& g : program.globals) {
+        globals[g.name] = Var{0, g.type, g.className};
+    }
+
+    out << "# Сгенерировано cppTranslator; сборка: as -o prog.o prog.s && ld -o prog prog.o\n";
+    out << "    .intel_syntax noprefix\n";
+    out << "    .text\n";
+    out << "    .globl _start\n";
+
+    for (const AstClass& cls : program.classes) {
+        currentClass = cls.name;
+        for (const AstMethod& m : cls.methods) {
+            returnType = m.type;
+            currentMethod = m.name;
+            function("u." + cls.name + "." + m.name, m.body, false);
+        }
+    }
+    currentClass.clear();
+    returnType = IntType;
+    function("_start", program.main, true);
+
+    out << Runtime;
+    out << "rt_strD2I:\n    .asciz " << asciz(NoticeD2I) << "\n";
+    out << "rt_strI2D:\n    .asciz " << asciz(NoticeI2D) << "\n";
+    for (const auto& [text, name] : strings) {
+        out << name << ":\n    .asciz " << asciz(text) << "\n";
+    }
+    out << "    .align 8\n";
+    for (const auto& [bits, name] : doubles) {
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "0x%016llX", static_cast<unsigned long long>(bits));
+        out << name << ":\n    .quad " << buf << "\n";
+    }
+
+    out << "\n    .bss\n    .align 8\n";
+    for (const AstVar& g : program.globals) {
+        uint32_t size = 1;
+        if (g.type == UndefinedType) {
+            auto layout = layouts.find(g.className);
+            size = layout != layouts.end() ? layout->second.size : 0;
+        }
+        out << "u." << g.name << ":\n    .zero " << (size ? 8 * size : 8) << "\n";
+    }
+    out << RuntimeData;
+}
+
+}  // namespace
+
+void emitAsm(const AstProgram& program, std::ostream& out) {
+    AsmWriter(out).program(program);
+}
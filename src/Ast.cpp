@@ -0,0 +1,443 @@
+#include "Ast.hpp"
+
+#include <stdexcept>
+
+#include "Parser.hpp"
+#include "Scanner.hpp"
+
+const std::string& AstDesignator::fullName() const {
+    return site->fullName;
+}
+
+namespace {
+
+// Разбор повторяет Parser, но только строит дерево: проверки уже пройдены.
+class AstBuilder {
+public:
+    AstBuilder(Scanner& scanner, const Parser& parser) : scanner(scanner), parser(parser) {}
+
+    AstProgram build();
+
+private:
+    struct Mark {
+        uint32_t pos;
+        std::string token;
+        uint16_t code;
+    };
+
+    Scanner& scanner;
+    const Parser& parser;
+    std::string token;
+    uint16_t code = 0;
+
+    void next() { code = scanner.scan(token); }
+    Mark mark() const { return Mark{scanner.getPos(), token, code}; }
+    void rewind(const Mark& m) {
+        scanner.setPos(m.pos);
+        token = m.token;
+        code = m.code;
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("генерация кода: " + message);
+    }
+    void expect(uint16_t c) {
+        if (code != c) fail("неожиданный токен '" + token + "'");
+        next();
+    }
+    std::string expectId() {
+        std::string name = token;
+        expect(TId);
+        return name;
+    }
+
+    // Type(): int, double или имя класса
+    PrimitiveDataType type(std::string& className);
+
+    void description(AstProgram& program);
+    AstClass classDesc();
+    void operators(std::vector<AstStmt>& out);
+    void operatorStmt(std::vector<AstStmt>& out);
+    AstStmt statement();
+    AstStmt whileStmt();
+    AstStmt returnStmt();
+
+    AstDesignator designator();
+    std::unique_ptr<AstExpr> numeric(std::unique_ptr<AstExpr> e) const;
+    std::unique_ptr<AstExpr> expression();
+    std::unique_ptr<AstExpr> sum();
+    std::unique_ptr<AstExpr> mult();
+    std::unique_ptr<AstExpr> unary();
+    std::unique_ptr<AstExpr> base();
+    std::unique_ptr<AstExpr> binary(uint16_t op, std::unique_ptr<AstExpr> l, std::unique_ptr<AstExpr> r) const;
+};
+
+PrimitiveDataType AstBuilder::type(std::string& className) {
+    className.clear();
+    if (code == TInt) {
+        next();
+        return IntType;
+    }
+    if (code == TDouble) {
+        next();
+        return DoubleType;
+    }
+    className = expectId();
+    return UndefinedType;
+}
+
+AstProgram AstBuilder::build() {
+    AstProgram program;
+    scanner.reset();
+    next();
+
+    while (code == TClass || code == TInt || code == TDouble || code == TId) {
+        if (code == TInt) {
+            Mark m = mark();
+            next();
+            bool isMain = (code == TMain);
+            rewind(m);
+            if (isMain) break;
+        }
+        description(program);
+    }
+
+    expect(TInt);
+    expect(TMain);
+    expect(TLB);
+    expect(TRB);
+    expect(TLFB);
+    operators(program.main);
+    expect(TRFB);
+    return program;
+}
+
+void AstBuilder::description(AstProgram& program) {
+    if (code == TClass) {
+        program.classes.push_back(classDesc());
+        return;
+    }
+
+    AstVar var;
+    var.type = type(var.className);
+    var.name = expectId();
+
+    // константа подставляется в выражения по своему designator'у
+    if (code == TEval) {
+        next();
+        next();
+        expect(TSemicolon);
+        return;
+    }
+    expect(TSemicolon);
+    program.globals.push_back(std::move(var));
+}
+
+AstClass AstBuilder::classDesc() {
+    AstClass cls;
+    expect(TClass);
+    cls.name = expectId();
+    expect(TLFB);
+
+    while (code == TInt || code == TDouble || code == TId) {
+        std::string className;
+        PrimitiveDataType t = type(className);
+        std::string name = expectId();
+
+        if (code == TLB) {
+            AstMethod method;
+            method.name = name;
+            method.type = t;
+            next();
+            expect(TRB);
+            expect(TLFB);
+            operators(method.body);
+            expect(TRFB);
+            cls.methods.push_back(std::move(method));
+            continue;
+        }
+
+        cls.fields.push_back(AstVar{name, t, className});
+        while (code == TComma) {
+            next();
+            cls.fields.push_back(AstVar{expectId(), t, className});
+        }
+        expect(TSemicolon);
+    }
+
+    expect(TRFB);
+    expect(TSemicolon);
+    return cls;
+}
+
+void AstBuilder::operators(std::vector<AstStmt>& out) {
+    while (code != TRFB && code != TEnd) {
+        operatorStmt(out);
+    }
+}
+
+void AstBuilder::operatorStmt(std::vector<AstStmt>& out) {
+    if (code == TSemicolon) {
+        next();
+    } else if (code == TLFB) {
+        next();
+        AstStmt block;
+        operators(block.body);
+        expect(TRFB);
+        out.push_back(std::move(block));
+    } else if (code == TWhile) {
+        out.push_back(whileStmt());
+    } else if (code == TReturn) {
+        out.push_back(returnStmt());
+    } else {
+        out.push_back(statement());
+    }
+}
+
+AstStmt AstBuilder::statement() {
+    AstStmt s;
+
+    if (code == TInc || code == TDec) {
+        s.kind = AstStmt::Step;
+        s.op = code;
+        next();
+        s.target = designator();
+        expect(TSemicolon);
+        return s;
+    }
+
+    if (code == TInt || code == TDouble) {
+        s.kind = AstStmt::Decl;
+        s.type = (code == TInt) ? IntType : DoubleType;
+        next();
+        s.name = expectId();
+        if (code == TEval) {
+            next();
+            s.expr = numeric(expression());
+        }
+        expect(TSemicolon);
+        return s;
+    }
+
+    // TypeName varName;
+    Mark m = mark();
+    std::string first = expectId();
+    if (code == TId) {
+        s.kind = AstStmt::ObjectDecl;
+        s.className = first;
+        s.name = token;
+        next();
+        expect(TSemicolon);
+        return s;
+    }
+    rewind(m);
+
+    s.target = designator();
+    if (s.target.call) {
+        s.kind = AstStmt::Call;
+    } else if (code == TInc || code == TDec) {
+        s.kind = AstStmt::Step;
+        s.op = code;
+        next();
+    } else {
+        s.kind = AstStmt::Assign;
+        switch (code) {
+            case TEval:    s.op = TEval;  break;
+            case TPlusEq:  s.op = TPlus;  break;
+            case TMinusEq: s.op = TMinus; break;
+            case TMultEq:  s.op = TMult;  break;
+            case TDivEq:   s.op = TDiv;   break;
+            case TModEq:   s.op = TMod;   break;
+            default: fail("неожиданный токен '" + token + "'");
+        }
+        next();
+        s.expr = numeric(expression());
+    }
+    expect(TSemicolon);
+    return s;
+}
+
+AstStmt AstBuilder::whileStmt() {
+    AstStmt s;
+    s.kind = AstStmt::While;
+    expect(TWhile);
+    expect(TLB);
+    s.expr = numeric(expression());
+    expect(TRB);
+    operatorStmt(s.body);
+    if (s.body.empty()) {
+        s.body.emplace_back();  // тело из ';' - пустой блок
+    }
+    return s;
+}
+
+AstStmt AstBuilder::returnStmt() {
+    AstStmt s;
+    s.kind = AstStmt::Return;
+    expect(TReturn);
+    s.expr = numeric(expression());
+    expect(TSemicolon);
+    return s;
+}
+
+AstDesignator AstBuilder::designator() {
+    AstDesignator d;
+    d.site = parser.siteAt(scanner.getTokenStartPos());
+    if (!d.site) {
+        fail("имя '" + token + "' не разобрано анализом");
+    }
+
+    d.path.push_back(expectId());
+    while (code == TPoint) {
+        next();
+        d.path.push_back(expectId());
+    }
+    if (code == TLB) {
+        next();
+        expect(TRB);
+        d.call = true;
+    }
+
+    d.type = d.site->type;
+    if (d.site->frameSlot != Node::NoSlot) {
+        d.root = AstDesignator::Local;
+    } else {
+        switch (d.site->root->getNode()->objType) {
+            case ObjField:  d.root = AstDesignator::Field;  break;
+            case ObjMethod: d.root = AstDesignator::Method; break;
+            default:        d.root = AstDesignator::Global; break;
+        }
+    }
+    return d;
+}
+
+std::unique_ptr<AstExpr> AstBuilder::numeric(std::unique_ptr<AstExpr> e) const {
+    if (e->type != IntType && e->type != DoubleType) {
+        fail("объект в выражении не поддерживается");
+    }
+    return e;
+}
+
+std::unique_ptr<AstExpr> AstBuilder::binary(uint16_t op, std::unique_ptr<AstExpr> l,
+                                            std::unique_ptr<AstExpr> r) const {
+    auto e = std::make_unique<AstExpr>();
+    e->kind = AstExpr::Binary;
+    e->op = op;
+    e->left = numeric(std::move(l));
+    e->right = numeric(std::move(r));
+    if (isCompareOp(op)) {
+        e->type = IntType;
+    } else {
+        e->type = (e->left->type == DoubleType || e->right->type == DoubleType) ? DoubleType : IntType;
+    }
+    return e;
+}
+
+std::unique_ptr<AstExpr> AstBuilder::expression() {
+    auto left = sum();
+    if (isCompareOp(code)) {
+        uint16_t op = code;
+        next();
+        left = binary(op, std::move(left), sum());
+    }
+    return left;
+}
+
+std::unique_ptr<AstExpr> AstBuilder::sum() {
+    auto acc = mult();
+    while (code == TPlus || code == TMinus) {
+        uint16_t op = code;
+        next();
+        acc = binary(op, std::move(acc), mult());
+    }
+    return acc;
+}
+
+std::unique_ptr<AstExpr> AstBuilder::mult() {
+    auto acc = unary();
+    while (code == TMult || code == TDiv || code == TMod) {
+        uint16_t op = code;
+        next();
+        acc = binary(op, std::move(acc), unary());
+    }
+    return acc;
+}
+
+std::unique_ptr<AstExpr> AstBuilder::unary() {
+    if (code == TInc || code == TDec) {
+        auto e = std::make_unique<AstExpr>();
+        e->kind = AstExpr::PreInc;
+        e->op = code;
+        next();
+        e->ref = designator();
+        e->type = e->ref.type;
+        return e;
+    }
+
+    bool negate = (code == TMinus);
+    if (code == TPlus || code == TMinus) {
+        next();
+    }
+
+    auto e = base();
+    if (!negate) {
+        return e;
+    }
+    auto neg = std::make_unique<AstExpr>();
+    neg->kind = AstExpr::Neg;
+    neg->left = numeric(std::move(e));
+    neg->type = neg->left->type;
+    return neg;
+}
+
+std::unique_ptr<AstExpr> AstBuilder::base() {
+    auto e = std::make_unique<AstExpr>();
+
+    if (code == TConstInt) {
+        e->type = IntType;
+        e->value = TData::Int(std::stoi(token));
+        next();
+        return e;
+    }
+    if (code == TConstDouble) {
+        e->type = DoubleType;
+        e->value = TData::Double(std::stod(token));
+        next();
+        return e;
+    }
+    if (code == TLB) {
+        next();
+        e = expression();
+        expect(TRB);
+        return e;
+    }
+
+    e->ref = designator();
+    e->type = e->ref.type;
+
+    // глобальная константа: значение, оставленное ей анализом
+    const DesignatorSite* site = e->ref.site;
+    if (!e->ref.call && !site->member && site->root &&
+        site->root->getNode()->objType == ObjConst) {
+        e->kind = AstExpr::Const;
+        e->value = site->root->getNode()->data;
+        return e;
+    }
+
+    if (e->ref.call) {
+        e->kind = AstExpr::Call;
+    } else if (code == TInc || code == TDec) {
+        e->kind = AstExpr::PostInc;
+        e->op = code;
+        next();
+    } else {
+        e->kind = AstExpr::Var;
+    }
+    return e;
+}
+
+}  // namespace
+
+AstProgram buildAst(Scanner& scanner, const Parser& parser) {
+    return AstBuilder(scanner, parser).build();
+}
@@ -0,0 +1,462 @@
+#include "CodeGen.hpp"
+
+#include <cstdio>
+#include <string>
+
+#include "Expr.hpp"
+
+namespace {
+
+// Поддержка выполнения: те же правила, что в Parser::assignValue,
+// printAssignment и intArith/doubleArith. Печать буферизуется,
+// перед предупреждением в std::cerr буфер сбрасывается.
+const char* const Prelude = R"cpp(#include <cstdint>
+#include <iostream>
+
+static inline void rt_warn(const char* text) {
+    std::cout.flush();
+    std::cerr << text << std::endl;
+}
+
+static inline void rt_print(const char* name, int v) { std::cout << name << " = " << v << '\n'; }
+static inline void rt_print(const char* name, double v) { std::cout << name << " = " << v << '\n'; }
+
+// static_cast<int> как cvttsd2si: NaN и выход за диапазон дают INT32_MIN
+static inline int rt_trunc(double v) {
+    return (v > -2147483649.0 && v < 2147483648.0) ? static_cast<int>(v) : INT32_MIN;
+}
+static inline int rt_toInt(double v, const char* name) {
+    std::cout << "приведение типа (double -> int) при присваивании '" << name << "'\n";
+    return rt_trunc(v);
+}
+static inline double rt_toDouble(int v, const char* name) {
+    std::cout << "приведение типа (int -> double) при присваивании '" << name << "'\n";
+    return static_cast<double>(v);
+}
+
+// int по модулю 2^32
+static inline int rt_add(int a, int b) { return static_cast<int>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+static inline int rt_sub(int a, int b) { return static_cast<int>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+static inline int rt_mul(int a, int b) { return static_cast<int>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b)); }
+static inline int rt_neg(int a) { return static_cast<int>(0u - static_cast<uint32_t>(a)); }
+// как wrapDiv/wrapMod: INT_MIN / -1 == INT_MIN, INT_MIN % -1 == 0, на 0 - 0
+static inline int rt_wrapDiv(int a, int b) {
+    if (b == 0) return 0;
+    return (b == -1) ? rt_neg(a) : a / b;
+}
+static inline int rt_wrapMod(int a, int b) { return (b == 0 || b == -1) ? 0 : a % b; }
+static inline int rt_div(int a, int b) {
+    if (b == 0) {
+        rt_warn("Warning: division by zero (int)");
+    }
+    return rt_wrapDiv(a, b);
+}
+static inline int rt_mod(int a, int b) {
+    if (b == 0) {
+        rt_warn("Warning: modulo by zero");
+    }
+    return rt_wrapMod(a, b);
+}
+static inline double rt_ddiv(double a, double b) {
+    if (b == 0.0) {
+        rt_warn("Warning: division by zero (double)");
+        return 0.0;
+    }
+    return a / b;
+}
+static inline double rt_dmod(double a, double b) {
+    rt_warn("Warning: operator % for double, casting to int");
+    return rt_wrapMod(rt_trunc(a), rt_trunc(b));
+}
+)cpp";
+
+std::string name(const std::string& id) {
+    return "u_" + id;
+}
+
+const char* typeName(PrimitiveDataType t) {
+    return t == DoubleType ? "double" : "int";
+}
+
+std::string quoted(const std::string& s) {
+    return "\"" + s + "\"";
+}
+
+std::string literal(const TData& v, PrimitiveDataType t) {
+    if (t != DoubleType) {
+        return std::to_string(v.asInt());
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%.17g", v.asDouble());
+    std::string s = buf;
+    if (s.find_first_of(".e") == std::string::npos) s += ".0";
+    return s;
+}
+
+// Выражение без побочных эффектов и предупреждений можно вычислять в
+// любом порядке, остальные раскладываются на временные по порядку разбора.
+bool pure(const AstExpr& e) {
+    switch (e.kind) {
+        case AstExpr::Const:
+        case AstExpr::Var:
+            return true;
+        case AstExpr::Neg:
+            return pure(*e.left);
+        case AstExpr::Binary:
+            if (e.op == TDiv || e.op == TMod) {
+                bool silent = e.type == IntType && e.right->kind == AstExpr::Const &&
+                              e.right->value.asInt() != 0;
+                if (!silent) return false;
+            }
+            return pure(*e.left) && pure(*e.right);
+        default:
+            return false;
+    }
+}
+
+class CppWriter {
+public:
+    explicit CppWriter(std::ostream& out) : out(out) {}
+
+    void program(const AstProgram& program);
+
+private:
+    std::ostream& out;
+    int depth = 0;
+    uint32_t temps = 0;
+    bool inMain = false;
+    bool quiet = false;
+    PrimitiveDataType returnType = IntType;
+    std::string method;     // имя метода для сообщений о приведении результата
+
+    std::ostream& line() {
+        for (int i = 0; i < depth; ++i) out << "    ";
+        return out;
+    }
+
+    std::string place(const AstDesignator& d) const;
+    std::string convert(const std::string& v, PrimitiveDataType from, PrimitiveDataType to) const;
+    std::string binary(uint16_t op, PrimitiveDataType type,
+                       std::string l, PrimitiveDataType lt,
+                       std::string r, PrimitiveDataType rt) const;
+    std::string step(const std::string& p, PrimitiveDataType t, uint16_t op) const;
+
+    std::string temp(PrimitiveDataType t, const std::string& v);
+    std::string text(const AstExpr& e) const;
+    std::string value(const AstExpr& e);
+
+    std::string assigned(const std::string& v, PrimitiveDataType from,
+                         PrimitiveDataType to, const std::string& decl) const;
+    void print(const std::string& label, const std::string& v);
+    void assign(const AstDesignator& target, const std::string& v, PrimitiveDataType vt);
+    void function(const std::vector<AstStmt>& body);
+    void statements(const std::vector<AstStmt>& body);
+    void statement(const AstStmt& s);
+};
+
+std::string CppWriter::place(const AstDesignator& d) const {
+    std::string p;
+    switch (d.root) {
+        case AstDesignator::Local:  p = name(d.path[0]); break;
+        case AstDesignator::Global: p = "::" + name(d.path[0]); break;
+        default:                    p = "this->" + name(d.path[0]); break;
+    }
+    for (size_t i = 1; i < d.path.size(); ++i) {
+        p += "." + name(d.path[i]);
+    }
+    if (d.call) p += "()";
+    return p;
+}
+
+std::string CppWriter::convert(const std::string& v, PrimitiveDataType from, PrimitiveDataType to) const {
+    return (from == IntType && to == DoubleType) ? "static_cast<double>(" + v + ")" : v;
+}
+
+std::string CppWriter::binary(uint16_t op, PrimitiveDataType type,
+                              std::string l, PrimitiveDataType lt,
+                              std::string r, PrimitiveDataType rt) const {
+    const PrimitiveDataType common = (lt == DoubleType || rt == DoubleType) ? DoubleType : IntType;
+    l = convert(l, lt, common);
+    r = convert(r, rt, common);
+
+    if (isCompareOp(op)) {
+        const char* rel = "";
+        switch (op) {
+            case TL:    rel = " < ";  break;
+            case TG:    rel = " > ";  break;
+            case TLE:   rel = " <= "; break;
+            case TGE:   rel = " >= "; break;
+            case TEq:   rel = " == "; break;
+            default:    rel = " != "; break;
+        }
+        return "int(" + l + rel + r + ")";
+    }
+
+    if (type == IntType) {
+        const char* fn = "";
+        switch (op) {
+            case TPlus:  fn = "rt_add"; break;
+            case TMinus: fn = "rt_sub"; break;
+            case TMult:  fn = "rt_mul"; break;
+            case TDiv:   fn = "rt_div"; break;
+            default:     fn = "rt_mod"; break;
+        }
+        return std::string(fn) + "(" + l + ", " + r + ")";
+    }
+
+    switch (op) {
+        case TPlus:  return "(" + l + " + " + r + ")";
+        case TMinus: return "(" + l + " - " + r + ")";
+        case TMult:  return "(" + l + " * " + r + ")";
+        case TDiv:   return "rt_ddiv(" + l + ", " + r + ")";
+        default:     return "rt_dmod(" + l + ", " + r + ")";
+    }
+}
+
+std::string CppWriter::step(const std::string& p, PrimitiveDataType t, uint16_t op) const {
+    if (t == IntType) {
+        return (op == TInc ? "rt_add(" : "rt_sub(") + p + ", 1)";
+    }
+    return "(" + p + (op == TInc ? " + 1.0)" : " - 1.0)");
+}
+
+std::string CppWriter::temp(PrimitiveDataType t, const std::string& v) {
+    std::string id = "t" + std::to_string(temps++);
+    line() << "const " << typeName(t) << " " << id << " = " << v << ";\n";
+    return id;
+}
+
+std::string CppWriter::text(const AstExpr& e) const {
+    switch (e.kind) {
+        case AstExpr::Const:
+            return literal(e.value, e.type);
+        case AstExpr::Var:
+            return place(e.ref);
+        case AstExpr::Neg:
+            return e.type == IntType ? "rt_neg(" + text(*e.left) + ")" : "(-" + text(*e.left) + ")";
+        default:
+            return binary(e.op, e.type, text(*e.left), e.left->type, text(*e.right), e.right->type);
+    }
+}
+
+std::string CppWriter::value(const AstExpr& e) {
+    if (pure(e)) {
+        return text(e);
+    }
+
+    switch (e.kind) {
+        case AstExpr::Call:
+            return temp(e.type, place(e.ref));
+        case AstExpr::PreInc: {
+            std::string p = place(e.ref);
+            line() << p << " = " << step(p, e.type, e.op) << ";\n";
+            return temp(e.type, p);
+        }
+        case AstExpr::PostInc: {
+            std::string p = place(e.ref);
+            std::string old = temp(e.type, p);
+            line() << p << " = " << step(p, e.type, e.op) << ";\n";
+            return old;
+        }
+        case AstExpr::Neg: {
+            std::string v = value(*e.left);
+            return temp(e.type, e.type == IntType ? "rt_neg(" + v + ")" : "-" + v);
+        }
+        default: {
+            std::string l = value(*e.left);
+            if (pure(*e.left) && !pure(*e.right)) {
+                l = temp(e.left->type, l);
+            }
+            std::string r = value(*e.right);
+            return temp(e.type, binary(e.op, e.type, l, e.left->type, r, e.right->type));
+        }
+    }
+}
+
+// значение другого типа приводится с сообщением, как в assignValue
+std::string CppWriter::assigned(const std::string& v, PrimitiveDataType from,
+                                PrimitiveDataType to, const std::string& decl) const {
+    if (to == IntType && from == DoubleType) {
+        return "rt_toInt(" + v + ", " + quoted(decl) + ")";
+    }
+    if (to == DoubleType && from == IntType) {
+        return "rt_toDouble(" + v + ", " + quoted(decl) + ")";
+    }
+    return v;
+}
+
+// печать присваивания, как printAssignment; при quiet её нет
+void CppWriter::print(const std::string& label, const std::string& v) {
+    if (!quiet) {
+        line() << "rt_print(" << quoted(label) << ", " << v << ");\n";
+    }
+}
+
+// присваивание с печатью, как assignValue + printAssignment
+void CppWriter::assign(const AstDesignator& target, const std::string& v, PrimitiveDataType vt) {
+    std::string p = place(target);
+    line() << p << " = " << assigned(v, vt, target.type, target.declName()) << ";\n";
+    print(target.fullName(), p);
+}
+
+void CppWriter::statements(const std::vector<AstStmt>& body) {
+    for (const AstStmt& s : body) {
+        statement(s);
+    }
+}
+
+void CppWriter::statement(const AstStmt& s) {
+    switch (s.kind) {
+        case AstStmt::Block:
+            line() << "{\n";
+            ++depth;
+            statements(s.body);
+            --depth;
+            line() << "}\n";
+            break;
+
+        case AstStmt::Decl: {
+            if (!s.expr) {
+                line() << typeName(s.type) << " " << name(s.name)
+                       << (s.type == DoubleType ? " = 0.0;\n" : " = 0;\n");
+                break;
+            }
+            // инициализатор видит внешнюю переменную с тем же именем
+            std::string v = value(*s.expr);
+            if (pure(*s.expr) && s.expr->kind != AstExpr::Const) {
+                v = temp(s.expr->type, v);
+            }
+            line() << typeName(s.type) << " " << name(s.name) << " = "
+                   << assigned(v, s.expr->type, s.type, s.name) << ";\n";
+            print(s.name, name(s.name));
+            break;
+        }
+
+        case AstStmt::ObjectDecl:
+            line() << "struct " << name(s.className) << " " << name(s.name) << "{};\n";
+            break;
+
+        case AstStmt::Assign: {
+            std::string v = value(*s.expr);
+            if (s.op == TEval) {
+                assign(s.target, v, s.expr->type);
+                break;
+            }
+            // составное: текущее значение читается после правой части
+            const PrimitiveDataType resType =
+                (s.target.type == DoubleType || s.expr->type == DoubleType) ? DoubleType : IntType;
+            assign(s.target, binary(s.op, resType, place(s.target), s.target.type, v, s.expr->type),
+                   resType);
+            break;
+        }
+
+        case AstStmt::Step: {
+            std::string p = place(s.target);
+            line() << p << " = " << step(p, s.target.type, s.op) << ";\n";
+            print(s.target.fullName(), p);
+            break;
+        }
+
+        case AstStmt::Call:
+            line() << place(s.target) << ";\n";
+            break;
+
+        case AstStmt::While: {
+            const std::vector<AstStmt>& body =
+                s.body[0].kind == AstStmt::Block ? s.body[0].body : s.body;
+            if (pure(*s.expr)) {
+                line() << "while (" << text(*s.expr) << " != 0) {\n";
+                ++depth;
+            } else {
+                line() << "while (true) {\n";
+                ++depth;
+                std::string c = value(*s.expr);
+                line() << "if (" << c << " == 0) break;\n";
+            }
+            statements(body);
+            --depth;
+            line() << "}\n";
+            break;
+        }
+
+        case AstStmt::Return: {
+            std::string v = value(*s.expr);
+            if (inMain || returnType == UndefinedType) {
+                if (!pure(*s.expr)) line() << "(void)" << v << ";\n";
+                line() << (inMain ? "return 0;\n" : "return;\n");
+                break;
+            }
+            // результат приводится к типу метода, как при присваивании
+            line() << "return " << assigned(v, s.expr->type, returnType, method) << ";\n";
+            break;
+        }
+    }
+}
+
+// тело main или метода; метод без return возвращает 0
+void CppWriter::function(const std::vector<AstStmt>& body) {
+    temps = 0;
+    ++depth;
+    statements(body);
+    if (inMain) {
+        line() << "return 0;\n";
+    } else if (returnType != UndefinedType &&
+               (body.empty() || body.back().kind != AstStmt::Return)) {
+        line() << "return " << (returnType == DoubleType ? "0.0" : "0") << ";\n";
+    }
+    --depth;
+    line() << "}\n";
+}
+
+void CppWriter::program(const AstProgram& program) {
+    quiet = program.quiet;
+    out << "// Сгенерировано cppTranslator; сборка: c++ -O2 -std=c++17 -frounding-math\n" << Prelude;
+
+    for (const AstClass& cls : program.classes) {
+        out << "\nstruct " << name(cls.name) << " {\n";
+        for (const AstVar& f : cls.fields) {
+            if (f.type == UndefinedType) {
+                out << "    struct " << name(f.className) << " " << name(f.name) << "{};\n";
+            } else {
+                out << "    " << typeName(f.type) << " " << name(f.name)
+                    << (f.type == DoubleType ? " = 0.0;\n" : " = 0;\n");
+            }
+        }
+        for (const AstMethod& m : cls.methods) {
+            out << "    " << (m.type == UndefinedType ? "void" : typeName(m.type))
+                << " " << name(m.name) << "();\n";
+        }
+        out << "};\n";
+    }
+
+    if (!program.globals.empty()) out << "\n";
+    for (const AstVar& g : program.globals) {
+        if (g.type == UndefinedType) {
+            out << "struct " << name(g.className) << " " << name(g.name) << "{};\n";
+        } else {
+            out << typeName(g.type) << " " << name(g.name)
+                << (g.type == DoubleType ? " = 0.0;\n" : " = 0;\n");
+        }
+    }
+
+    for (const AstClass& cls : program.classes) {
+        for (const AstMethod& m : cls.methods) {
+            returnType = m.type;
+            method = m.name;
+            out << "\n" << (m.type == UndefinedType ? "void" : typeName(m.type)) << " "
+                << name(cls.name) << "::" << name(m.name) << "() {\n";
+            function(m.body);
+        }
+    }
+
+    inMain = true;
+    returnType = IntType;
+    out << "\nint main() {\n";
+    function(program.main);
+}
+
+}  // namespace
+
+void emitCpp(const AstProgram& program, std::ostream& out) {
+    CppWriter(out).program(program);
+}
@@ -0,0 +1,336 @@
+#include "Ast.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Expr.hpp"
+#include "Parser.hpp"
+
+namespace {
+
+// Делитель, на котором операция ничего не печатает: ненулевая константа
+// (INT_MIN / -1 не падает, см. wrapDiv).
+bool safeDivisor(const AstExpr& d, bool inDouble) {
+    if (d.kind != AstExpr::Const) return false;
+    if (inDouble) {
+        const double v = d.value.isDouble() ? d.value.asDouble() : static_cast<double>(d.value.asInt());
+        return v != 0.0;
+    }
+    return d.value.asInt() != 0;
+}
+
+// операция над значением типа lt и rhs: без предупреждений
+bool silentOp(uint16_t op, PrimitiveDataType lt, const AstExpr& rhs) {
+    const bool inDouble = lt == DoubleType || rhs.type == DoubleType;
+    if (op == TMod && inDouble) return false;
+    if (op == TDiv || op == TMod) return safeDivisor(rhs, inDouble);
+    return true;
+}
+
+// Выражение без побочных эффектов и без вывода: нет вызовов, ++/--,
+// деления на неизвестное или ноль и % над double.
+bool silent(const AstExpr& e) {
+    switch (e.kind) {
+        case AstExpr::Const:
+        case AstExpr::Var:
+            return true;
+        case AstExpr::Neg:
+            return silent(*e.left);
+        case AstExpr::Binary:
+            return silent(*e.left) && silent(*e.right) && silentOp(e.op, e.left->type, *e.right);
+        default:
+            return false;
+    }
+}
+
+// значение выражения из одних констант
+bool constantValue(const AstExpr& e, TData& out) {
+    switch (e.kind) {
+        case AstExpr::Const:
+            out = e.value;
+            return true;
+        case AstExpr::Neg: {
+            TData v;
+            if (!constantValue(*e.left, v)) return false;
+            out = v.isDouble() ? TData::Double(-v.asDouble()) : TData::Int(intArith<TMinus>(0, v.asInt()));
+            return true;
+        }
+        case AstExpr::Binary: {
+            TData l, r;
+            if (!silent(e) || !constantValue(*e.left, l) || !constantValue(*e.right, r)) return false;
+            out = binaryValue(e.op, l, r);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool neverTrue(const AstExpr& cond) {
+    TData v;
+    if (!constantValue(cond, v)) return false;
+    return v.isDouble() ? !(v.asDouble() != 0.0) : v.asInt() == 0;
+}
+
+// тело while - ровно один оператор
+void keepWhileBody(AstStmt& s) {
+    if (s.body.empty()) {
+        s.body.emplace_back();
+    }
+}
+
+// Удаляет операторы после return и циклы с ложным константным условием.
+// true - список всегда завершается return.
+bool dropUnreachable(std::vector<AstStmt>& body) {
+    for (size_t i = 0; i < body.size();) {
+        AstStmt& s = body[i];
+        if (s.kind == AstStmt::While && neverTrue(*s.expr)) {
+            body.erase(body.begin() + i);
+            continue;
+        }
+
+        bool returns = false;
+        if (s.kind == AstStmt::Return) {
+            returns = true;
+        } else if (s.kind == AstStmt::Block) {
+            returns = dropUnreachable(s.body);
+        } else if (s.kind == AstStmt::While) {
+            (void)dropUnreachable(s.body);
+            keepWhileBody(s);
+        }
+
+        if (returns) {
+            body.resize(i + 1);
+            return true;
+        }
+        ++i;
+    }
+    return false;
+}
+
+// ---- методы, не вызываемые из main ----
+
+using MethodKey = std::pair<std::string, std::string>;  // класс, метод
+
+MethodKey methodKey(const AstDesignator& d) {
+    Tree* method = d.site->member ? d.site->member : d.site->root;
+    return {method->getParent()->getNode()->id(), method->getNode()->id()};
+}
+
+void collectCalls(const AstExpr& e, std::vector<MethodKey>& out) {
+    if (e.kind == AstExpr::Call) out.push_back(methodKey(e.ref));
+    if (e.left) collectCalls(*e.left, out);
+    if (e.right) collectCalls(*e.right, out);
+}
+
+void collectCalls(const std::vector<AstStmt>& body, std::vector<MethodKey>& out) {
+    for (const AstStmt& s : body) {
+        if (s.kind == AstStmt::Call) out.push_back(methodKey(s.target));
+        if (s.expr) collectCalls(*s.expr, out);
+        collectCalls(s.body, out);
+    }
+}
+
+void dropUncalledMethods(AstProgram& program) {
+    std::map<MethodKey, const AstMethod*> methods;
+    for (const AstClass& cls : program.classes) {
+        for (const AstMethod& m : cls.methods) {
+            methods[{cls.name, m.name}] = &m;
+        }
+    }
+
+    std::set<MethodKey> called;
+    std::vector<MethodKey> calls;
+    collectCalls(program.main, calls);
+    while (!calls.empty()) {
+        MethodKey key = std::move(calls.back());
+        calls.pop_back();
+        auto it = methods.find(key);
+        if (it != methods.end() && called.insert(key).second) {
+            collectCalls(it->second->body, calls);
+        }
+    }
+
+    for (AstClass& cls : program.classes) {
+        std::erase_if(cls.methods, [&](const AstMethod& m) {
+            return !called.count({cls.name, m.name});
+        });
+    }
+}
+
+// ---- мёртвые записи локальных переменных ----
+
+// Локальные одной функции нумеруются в порядке объявлений, имя разрешается
+// по стеку областей, как при анализе. Первый обход считает чтения и
+// отмечает переменные с записями, которые нельзя удалить (вызов, сообщение
+// справа); второй тем же порядком удаляет записи в переменные без чтений.
+// Объявление такой переменной остаётся, удаляется лишь его инициализатор.
+class DeadStores {
+public:
+    bool run(std::vector<AstStmt>& body) {
+        locals.clear();
+        kept.clear();
+        declared = 0;
+        removing = false;
+        block(body);
+
+        declared = 0;
+        removing = true;
+        removed = false;
+        block(body);
+        return removed;
+    }
+
+private:
+    static constexpr uint32_t Pinned = UINT32_MAX;    // объект: не удаляется
+
+    std::vector<uint32_t> locals;   // число чтений
+    std::vector<bool> kept;         // есть запись, которая не удаляется
+    std::vector<std::vector<std::pair<std::string, uint32_t>>> scopes;
+    uint32_t declared = 0;
+    bool removing = false;
+    bool removed = false;
+
+    uint32_t declare(const std::string& name, uint32_t reads) {
+        if (!removing) {
+            locals.push_back(reads);
+            kept.push_back(false);
+        }
+        scopes.back().emplace_back(name, declared);
+        return declared++;
+    }
+
+    // номер числовой локальной, которой принадлежит designator, или Pinned
+    uint32_t local(const AstDesignator& d) const {
+        if (d.root != AstDesignator::Local || d.path.size() != 1) return Pinned;
+        for (size_t i = scopes.size(); i-- > 0;) {
+            for (size_t j = scopes[i].size(); j-- > 0;) {
+                if (scopes[i][j].first == d.path[0]) {
+                    const uint32_t id = scopes[i][j].second;
+                    return locals[id] == Pinned ? Pinned : id;
+                }
+            }
+        }
+        return Pinned;
+    }
+
+    bool dead(uint32_t id) const { return id != Pinned && locals[id] == 0; }
+
+    // запись без последствий, кроме значения в ячейке
+    static bool silentStore(const AstStmt& s) {
+        if (!silent(*s.expr)) return false;
+        if (s.op == TEval) return s.expr->type == s.target.type;
+        return !(s.target.type == IntType && s.expr->type == DoubleType) &&
+               silentOp(s.op, s.target.type, *s.expr);
+    }
+
+    void reads(const AstExpr& e) {
+        if (!removing && e.kind != AstExpr::Const && e.kind != AstExpr::Neg && e.kind != AstExpr::Binary) {
+            const uint32_t id = local(e.ref);
+            if (id != Pinned) locals[id]++;
+        }
+        if (e.left) reads(*e.left);
+        if (e.right) reads(*e.right);
+    }
+
+    void block(std::vector<AstStmt>& body) {
+        scopes.emplace_back();
+        size_t kept = 0;
+        for (size_t i = 0; i < body.size(); ++i) {
+            if (statement(body[i])) {
+                removed = true;
+                continue;
+            }
+            if (kept != i) body[kept] = std::move(body[i]);
+            ++kept;
+        }
+        body.resize(kept);
+        scopes.pop_back();
+    }
+
+    // true - оператор удаляется
+    bool statement(AstStmt& s) {
+        switch (s.kind) {
+            case AstStmt::Block:
+                block(s.body);
+                return false;
+
+            case AstStmt::Decl: {
+                // инициализатор видит внешнюю переменную с тем же именем
+                if (s.expr) reads(*s.expr);
+                const uint32_t id = declare(s.name, 0);
+                if (!removing || !dead(id)) return false;
+                const bool silentInit = !s.expr || (silent(*s.expr) && s.expr->type == s.type);
+                if (!kept[id]) return silentInit;
+                if (s.expr && silentInit) {
+                    s.expr.reset();
+                    removed = true;
+                }
+                return false;
+            }
+
+            case AstStmt::ObjectDecl:
+                declare(s.name, Pinned);
+                return false;
+
+            case AstStmt::Assign: {
+                reads(*s.expr);
+                // составное присваивание читает только свою же ячейку
+                const uint32_t id = local(s.target);
+                if (!removing) {
+                    if (id != Pinned && !silentStore(s)) kept[id] = true;
+                    return false;
+                }
+                return dead(id) && silentStore(s);
+            }
+
+            case AstStmt::Step:
+                return removing && dead(local(s.target));
+
+            case AstStmt::Call:
+                return false;
+
+            case AstStmt::While:
+                reads(*s.expr);
+                block(s.body);
+                keepWhileBody(s);
+                return false;
+
+            case AstStmt::Return:
+                reads(*s.expr);
+                return false;
+        }
+        return false;
+    }
+};
+
+void dropDeadStores(std::vector<AstStmt>& body) {
+    DeadStores stores;
+    while (stores.run(body)) {
+    }
+}
+
+}  // namespace
+
+void eliminateDeadCode(AstProgram& program) {
+    for (AstClass& cls : program.classes) {
+        for (AstMethod& m : cls.methods) {
+            (void)dropUnreachable(m.body);
+        }
+    }
+    (void)dropUnreachable(program.main);
+    dropUncalledMethods(program);
+
+    if (!program.quiet) {
+        return;
+    }
+    for (AstClass& cls : program.classes) {
+        for (AstMethod& m : cls.methods) {
+            dropDeadStores(m.body);
+        }
+    }
+    dropDeadStores(program.main);
+}
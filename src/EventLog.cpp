@@ -0,0 +1,81 @@
+#include "EventLog.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+EventLog::EventLog(const std::string& path) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("не удалось открыть журнал '" + path + "'");
+    }
+    map(InitialCapacity);
+
+    // заголовок без числа записей: журнал ещё не закрыт
+    *static_cast<EventLogHeader*>(base) = EventLogHeader();
+}
+
+EventLog::~EventLog() {
+    close();
+}
+
+static uint64_t fileSize(uint64_t records) {
+    return sizeof(EventLogHeader) + records * sizeof(EventRecord);
+}
+
+// Файл растёт удвоением; новые записи в нём нулевые (EventNone).
+void EventLog::map(uint64_t newCapacity) {
+    unmap();
+    if (::ftruncate(fd, static_cast<off_t>(fileSize(newCapacity))) != 0) {
+        throw std::runtime_error("не удалось увеличить журнал");
+    }
+    void* p = ::mmap(nullptr, fileSize(newCapacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        throw std::runtime_error("не удалось отобразить журнал в память");
+    }
+    base = p;
+    records = reinterpret_cast<EventRecord*>(static_cast<char*>(p) + sizeof(EventLogHeader));
+    capacity = newCapacity;
+}
+
+void EventLog::unmap() {
+    if (base) {
+        ::munmap(base, fileSize(capacity));
+        base = nullptr;
+        records = nullptr;
+    }
+}
+
+void EventLog::close() {
+    if (fd < 0) {
+        return;
+    }
+
+    EventLogHeader header;
+    header.count = count;
+    header.namesOffset = fileSize(count);
+    header.nameCount = NameTable::Size();
+    *static_cast<EventLogHeader*>(base) = header;
+    unmap();
+
+    std::string names;
+    for (uint32_t i = 0; i < header.nameCount; ++i) {
+        const std::string& name = NameTable::Get(i);
+        const uint32_t length = static_cast<uint32_t>(name.size());
+        names.append(reinterpret_cast<const char*>(&length), sizeof length);
+        names += name;
+    }
+
+    bool ok = ::ftruncate(fd, static_cast<off_t>(header.namesOffset)) == 0;
+    ok = ok && ::pwrite(fd, names.data(), names.size(), static_cast<off_t>(header.namesOffset)) ==
+                   static_cast<ssize_t>(names.size());
+    ::close(fd);
+    fd = -1;
+    // закрытие идёт и из деструктора, поэтому без исключения
+    if (!ok) {
+        std::cerr << "Ошибка: не удалось записать таблицу имён журнала" << std::endl;
+    }
+}
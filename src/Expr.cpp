@@ -0,0 +1,150 @@
+#include "Expr.hpp"
+
+#include <bit>
+#include <map>
+#include <tuple>
+
+#include "Parser.hpp"
+
+namespace {
+
+template <uint16_t Op>
+BinaryFn pickTypes(bool leftDouble, bool rightDouble) {
+    if (leftDouble) {
+        return rightDouble ? &binaryOp<Op, double, double> : &binaryOp<Op, double, int>;
+    }
+    return rightDouble ? &binaryOp<Op, int, double> : &binaryOp<Op, int, int>;
+}
+
+template <uint16_t Op>
+CompareFn pickCompare(bool leftDouble, bool rightDouble) {
+    if (leftDouble) {
+        return rightDouble ? &compareBranch<Op, double, double> : &compareBranch<Op, double, int>;
+    }
+    return rightDouble ? &compareBranch<Op, int, double> : &compareBranch<Op, int, int>;
+}
+
+}  // namespace
+
+// неопределённый тип (объект в выражении) исполняется по int-ветке, как и раньше
+BinaryFn binaryFn(uint16_t op, PrimitiveDataType lt, PrimitiveDataType rt) {
+    const bool ld = (lt == DoubleType);
+    const bool rd = (rt == DoubleType);
+    switch (op) {
+        case TPlus:  return pickTypes<TPlus>(ld, rd);
+        case TMinus: return pickTypes<TMinus>(ld, rd);
+        case TMult:  return pickTypes<TMult>(ld, rd);
+        case TDiv:   return pickTypes<TDiv>(ld, rd);
+        case TMod:   return pickTypes<TMod>(ld, rd);
+        case TL:     return pickTypes<TL>(ld, rd);
+        case TG:     return pickTypes<TG>(ld, rd);
+        case TLE:    return pickTypes<TLE>(ld, rd);
+        case TGE:    return pickTypes<TGE>(ld, rd);
+        case TEq:    return pickTypes<TEq>(ld, rd);
+        case TNotEq: return pickTypes<TNotEq>(ld, rd);
+        default:     return nullptr;
+    }
+}
+
+CompareFn compareFn(uint16_t op, PrimitiveDataType lt, PrimitiveDataType rt) {
+    const bool ld = (lt == DoubleType);
+    const bool rd = (rt == DoubleType);
+    switch (op) {
+        case TL:     return pickCompare<TL>(ld, rd);
+        case TG:     return pickCompare<TG>(ld, rd);
+        case TLE:    return pickCompare<TLE>(ld, rd);
+        case TGE:    return pickCompare<TGE>(ld, rd);
+        case TEq:    return pickCompare<TEq>(ld, rd);
+        case TNotEq: return pickCompare<TNotEq>(ld, rd);
+        default:     return nullptr;
+    }
+}
+
+namespace {
+
+// Ключ значения: вид узла и его операнды. Чтение переменной включает
+// эпоху - номер участка между побочными эффектами.
+using ValueKey = std::tuple<uint8_t, uint64_t, uint64_t, uint64_t, uint64_t>;
+
+struct ValueNumbering {
+    std::map<ValueKey, std::pair<uint32_t, ExprNode*>> table;
+    uint32_t values = 0;
+    uint32_t epoch = 0;
+    uint16_t temps = 0;
+
+    uint32_t unique() { return values++; }
+
+    // первое вхождение ключа становится представителем, повтор читает его значение
+    uint32_t lookup(const ValueKey& key, ExprNode* n, bool reuse = true) {
+        auto it = table.find(key);
+        if (it == table.end()) {
+            uint32_t vn = values++;
+            table.emplace(key, std::make_pair(vn, n));
+            return vn;
+        }
+
+        ExprNode* rep = it->second.second;
+        if (reuse && rep != n && temps != ExprNode::NoTemp) {
+            if (rep->temp == ExprNode::NoTemp) {
+                rep->temp = temps++;
+            }
+            n->kind = ExprTemp;
+            n->temp = rep->temp;
+            n->left = nullptr;
+            n->right = nullptr;
+            n->site = nullptr;
+        }
+        return it->second.first;
+    }
+
+    uint32_t visit(ExprNode* n) {
+        switch (n->kind) {
+            case ExprConst: {
+                return lookup({ExprConst, n->value.type(), n->value.raw(), 0, 0}, n, false);
+            }
+
+            case ExprVar: {
+                const DesignatorSite& s = *n->site;
+                uint64_t cell = s.member ? s.memberOffset : UINT64_MAX;
+                return lookup({ExprVar,
+                               (static_cast<uint64_t>(n->type) << 32) | s.frameSlot,
+                               reinterpret_cast<uintptr_t>(s.root), cell, epoch}, n);
+            }
+
+            case ExprCall:
+            case ExprInline:
+            case ExprPreInc:
+            case ExprPostInc:
+                epoch++;
+                return unique();
+
+            case ExprNeg:
+                return lookup({ExprNeg, visit(n->left), 0, 0, 0}, n);
+
+            case ExprBinary: {
+                uint32_t l = visit(n->left);
+                uint32_t r = visit(n->right);
+                // деление и остаток могут печатать предупреждение - не объединяем
+                if (n->op == TDiv || n->op == TMod) {
+                    return unique();
+                }
+                return lookup({ExprBinary, n->op, reinterpret_cast<uintptr_t>(n->fn), l, r}, n);
+            }
+
+            case ExprGroup:
+                return visit(n->left);
+
+            case ExprTemp:
+                break;
+        }
+        return unique();
+    }
+};
+
+}  // namespace
+
+uint16_t numberValues(ExprNode* root) {
+    ValueNumbering vn;
+    vn.visit(root);
+    return vn.temps;
+}
@@ -0,0 +1,645 @@
+#include "Jit.hpp"
+
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <iterator>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define JIT_X86_64 1
+#endif
+
+namespace {
+
+enum Reg : uint8_t { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// условия jcc/setcc
+enum Cond : uint8_t {
+    CondB = 0x2, CondAE = 0x3, CondE = 0x4, CondNE = 0x5, CondA = 0x7,
+    CondP = 0xA, CondNP = 0xB, CondL = 0xC, CondGE = 0xD, CondLE = 0xE, CondG = 0xF
+};
+
+// Кодирование нужного подмножества команд. Память адресуется как
+// [base + disp32], xmm-регистры - номерами 0..15.
+class Assembler {
+public:
+    std::vector<uint8_t> code;
+
+    void byte(uint8_t b) { code.push_back(b); }
+    void dword(uint32_t v) {
+        for (int i = 0; i < 4; ++i) byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+    void qword(uint64_t v) {
+        for (int i = 0; i < 8; ++i) byte(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    // op r/m, r: 01 add, 29 sub, 31 xor, 39 cmp, 85 test, 89 mov
+    void rr(uint8_t opcode, int dst, int src, bool wide = false) {
+        rex(wide, src, dst);
+        byte(opcode);
+        modrm(3, src, dst);
+    }
+    void load(int dst, int base, int32_t disp, bool wide = false) {
+        rex(wide, dst, base);
+        byte(0x8B);
+        mem(dst, base, disp);
+    }
+    void store(int base, int32_t disp, int src, bool wide = false) {
+        rex(wide, src, base);
+        byte(0x89);
+        mem(src, base, disp);
+    }
+    void cmpMem(int reg, int base, int32_t disp, bool wide = false) {
+        rex(wide, reg, base);
+        byte(0x3B);
+        mem(reg, base, disp);
+    }
+    void movImm32(int dst, uint32_t v) {
+        rex(false, 0, dst);
+        byte(0xB8 + (dst & 7));
+        dword(v);
+    }
+    void movImm64(int dst, uint64_t v) {
+        rex(true, 0, dst);
+        byte(0xB8 + (dst & 7));
+        qword(v);
+    }
+    // 81 /ext imm32: 0 add, 7 cmp
+    void imm(int ext, int dst, int32_t v, bool wide = false) {
+        rex(wide, 0, dst);
+        byte(0x81);
+        modrm(3, ext, dst);
+        dword(static_cast<uint32_t>(v));
+    }
+    void shr(int dst, uint8_t n, bool wide = false) {
+        rex(wide, 0, dst);
+        byte(0xC1);
+        modrm(3, 5, dst);
+        byte(n);
+    }
+    void imul(int dst, int src) {
+        rex(false, dst, src);
+        byte(0x0F);
+        byte(0xAF);
+        modrm(3, dst, src);
+    }
+    // F7 /ext: 3 neg, 7 idiv
+    void unary(int ext, int reg) {
+        rex(false, 0, reg);
+        byte(0xF7);
+        modrm(3, ext, reg);
+    }
+    void btc63(int reg) {
+        rex(true, 0, reg);
+        byte(0x0F);
+        byte(0xBA);
+        modrm(3, 7, reg);
+        byte(63);
+    }
+    void cdq() { byte(0x99); }
+    void push(int reg) {
+        if (reg >= 8) byte(0x41);
+        byte(0x50 + (reg & 7));
+    }
+    void pop(int reg) {
+        if (reg >= 8) byte(0x41);
+        byte(0x58 + (reg & 7));
+    }
+    // al/cl
+    void setcc(Cond c, int reg) {
+        byte(0x0F);
+        byte(0x90 + c);
+        modrm(3, 0, reg);
+    }
+    void movzxAl() {
+        byte(0x0F);
+        byte(0xB6);
+        modrm(3, RAX, RAX);
+    }
+    // 20 and, 08 or: al op= cl
+    void byteOp(uint8_t opcode) {
+        byte(opcode);
+        modrm(3, RCX, RAX);
+    }
+
+    // SSE2: prefix 66/F2, 0F opcode, reg - xmm
+    void sse(uint8_t prefix, uint8_t opcode, int reg, int rm, bool wide = false) {
+        byte(prefix);
+        rex(wide, reg, rm);
+        byte(0x0F);
+        byte(opcode);
+        modrm(3, reg, rm);
+    }
+    void sseMem(uint8_t prefix, uint8_t opcode, int reg, int base, int32_t disp) {
+        byte(prefix);
+        rex(false, reg, base);
+        byte(0x0F);
+        byte(opcode);
+        mem(reg, base, disp);
+    }
+    void movsd(int dst, int src) { sse(0xF2, 0x10, dst, src); }
+    void loadsd(int dst, int base, int32_t disp) { sseMem(0xF2, 0x10, dst, base, disp); }
+    void storesd(int base, int32_t disp, int src) { sseMem(0xF2, 0x11, src, base, disp); }
+    void movqToXmm(int xmm, int reg) { sse(0x66, 0x6E, xmm, reg, true); }
+    void movqFromXmm(int reg, int xmm) { sse(0x66, 0x7E, xmm, reg, true); }
+    void cvtsi2sd(int xmm, int reg) { sse(0xF2, 0x2A, xmm, reg); }
+
+    // переход вперёд: возвращает место для bind
+    size_t jcc(Cond c) {
+        byte(0x0F);
+        byte(0x80 + c);
+        dword(0);
+        return code.size();
+    }
+    void bind(size_t patch) {
+        int32_t rel = static_cast<int32_t>(code.size() - patch);
+        std::memcpy(&code[patch - 4], &rel, 4);
+    }
+    void jmpBack(size_t target) {
+        byte(0xE9);
+        dword(static_cast<uint32_t>(static_cast<int32_t>(target - (code.size() + 4))));
+    }
+    void ret() { byte(0xC3); }
+
+private:
+    void rex(bool wide, int reg, int rm) {
+        uint8_t r = 0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0);
+        if (r != 0x40) byte(r);
+    }
+    void modrm(int mod, int reg, int rm) {
+        byte(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+    }
+    void mem(int reg, int base, int32_t disp) {
+        modrm(2, reg, base);
+        if ((base & 7) == RSP) byte(0x24);
+        dword(static_cast<uint32_t>(disp));
+    }
+};
+
+// Место значения ExprVar: регистр, ячейка кадра с приведённым значением или
+// TData в памяти (поле получателя, глобальная), читаемое как asInt/asDouble.
+struct VarPlace {
+    enum Kind : uint8_t { InGpr, InXmm, InFrame, InData, AtAddress };
+
+    Kind kind = InFrame;
+    int reg = 0;
+    int32_t disp = 0;
+    const TData* address = nullptr;
+};
+
+bool numeric(PrimitiveDataType t) {
+    return t == IntType || t == DoubleType;
+}
+
+const ExprNode* unGroup(const ExprNode* n) {
+    while (n->kind == ExprGroup) {
+        n = n->left;
+    }
+    return n;
+}
+
+// деление и остаток - только на ненулевую константу, как у silentOp
+bool constDivisor(const ExprNode* n) {
+    const bool dbl = n->left->type == DoubleType || n->right->type == DoubleType;
+    if (n->op == TMod && dbl) {
+        return false;
+    }
+    const ExprNode* r = unGroup(n->right);
+    if (r->kind != ExprConst) {
+        return false;
+    }
+    return (n->right->type == DoubleType) ? r->value.asDouble() != 0.0 : r->value.asInt() != 0;
+}
+
+// Дерево выражения: int-значение в eax, double - в xmm0. Типы узлов и
+// операции те же, что выбраны при анализе, поэтому результат совпадает с
+// интерпретатором; узлы, которые могут печатать или вызывать, не компилируются.
+struct ExprCompiler {
+    Assembler& a;
+    std::function<bool(const DesignatorSite*, VarPlace&)> place;
+    int tempBase = RDI;
+    int32_t tempDisp = 0;
+
+    static bool simple(const ExprNode* n) {
+        return n->kind == ExprTemp ||
+               ((n->kind == ExprConst || n->kind == ExprVar) && n->temp == ExprNode::NoTemp);
+    }
+
+    // лист в eax/xmm0 или ecx/xmm1
+    bool leaf(const ExprNode* n, bool second) {
+        const bool dbl = (n->type == DoubleType);
+        const int gpr = second ? RCX : RAX;
+        const int xmm = second ? 1 : 0;
+
+        switch (n->kind) {
+            case ExprConst:
+                if (n->value.type() != (dbl ? TYPE_DOUBLE : TYPE_INT)) {
+                    return false;
+                }
+                if (dbl) {
+                    a.movImm64(R8, n->value.raw());
+                    a.movqToXmm(xmm, R8);
+                } else {
+                    a.movImm32(gpr, static_cast<uint32_t>(n->value.asInt()));
+                }
+                return true;
+
+            case ExprTemp:
+                if (dbl) a.loadsd(xmm, tempBase, tempDisp + 8 * n->temp);
+                else a.load(gpr, tempBase, tempDisp + 8 * n->temp);
+                return true;
+
+            case ExprVar: {
+                VarPlace p;
+                if (!place(n->site, p)) {
+                    return false;
+                }
+                switch (p.kind) {
+                    case VarPlace::InGpr:
+                        if (dbl) return false;
+                        a.rr(0x89, gpr, p.reg);
+                        return true;
+                    case VarPlace::InXmm:
+                        if (!dbl) return false;
+                        a.movsd(xmm, p.reg);
+                        return true;
+                    case VarPlace::InFrame:
+                        if (dbl) a.loadsd(xmm, RDI, p.disp);
+                        else a.load(gpr, RDI, p.disp);
+                        return true;
+                    default:
+                        break;
+                }
+
+                int base = RDI;
+                int32_t disp = p.disp;
+                if (p.kind == VarPlace::AtAddress) {
+                    a.movImm64(R8, reinterpret_cast<uintptr_t>(p.address));
+                    base = R8;
+                    disp = 0;
+                }
+                if (!dbl) {
+                    a.load(gpr, base, disp);
+                    return true;
+                }
+                // asDouble: значение с тегом int/неопределённое - младшие 32 бита
+                a.load(R8, base, disp, true);
+                a.rr(0x89, RCX, R8, true);
+                a.shr(RCX, 48, true);
+                a.imm(7, RCX, 0xFFFC);
+                size_t isDouble = a.jcc(CondB);
+                a.rr(0x89, R8, R8);
+                a.bind(isDouble);
+                a.movqToXmm(xmm, R8);
+                return true;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    bool value(const ExprNode* n) {
+        if (!numeric(n->type)) {
+            return false;
+        }
+        const bool dbl = (n->type == DoubleType);
+
+        switch (n->kind) {
+            case ExprConst:
+            case ExprVar:
+            case ExprTemp:
+                if (!leaf(n, false)) return false;
+                break;
+
+            case ExprGroup:
+            case ExprNeg:
+                if (n->left->type != n->type || !value(n->left)) {
+                    return false;
+                }
+                if (n->kind == ExprNeg) {
+                    if (dbl) {
+                        a.movqFromXmm(RAX, 0);
+                        a.btc63(RAX);
+                        a.movqToXmm(0, RAX);
+                    } else {
+                        a.unary(3, RAX);
+                    }
+                }
+                break;
+
+            case ExprBinary:
+                if (!binary(n)) return false;
+                break;
+
+            default:
+                return false;
+        }
+
+        if (n->kind != ExprTemp && n->temp != ExprNode::NoTemp) {
+            if (dbl) a.storesd(tempBase, tempDisp + 8 * n->temp, 0);
+            else a.store(tempBase, tempDisp + 8 * n->temp, RAX);
+        }
+        return true;
+    }
+
+    bool binary(const ExprNode* n) {
+        const ExprNode* l = n->left;
+        const ExprNode* r = n->right;
+        if (!n->fn || !numeric(l->type) || !numeric(r->type)) {
+            return false;
+        }
+        const bool dbl = (l->type == DoubleType || r->type == DoubleType);
+        const bool cmp = isCompareOp(n->op);
+        if (n->type != ((cmp || !dbl) ? IntType : DoubleType)) {
+            return false;
+        }
+        if ((n->op == TDiv || n->op == TMod) && !constDivisor(n)) {
+            return false;
+        }
+
+        // левый операнд - в eax/xmm0, правый - в ecx/xmm1
+        if (!value(l)) return false;
+        if (dbl && l->type == IntType) a.cvtsi2sd(0, RAX);
+
+        if (simple(r)) {
+            if (!leaf(r, true)) return false;
+            if (dbl && r->type == IntType) a.cvtsi2sd(1, RCX);
+        } else {
+            if (dbl) {
+                a.imm(5, RSP, 8, true);
+                a.storesd(RSP, 0, 0);
+            } else {
+                a.push(RAX);
+            }
+            if (!value(r)) return false;
+            if (dbl) {
+                if (r->type == IntType) a.cvtsi2sd(0, RAX);
+                a.movsd(1, 0);
+                a.loadsd(0, RSP, 0);
+                a.imm(0, RSP, 8, true);
+            } else {
+                a.rr(0x89, RCX, RAX);
+                a.pop(RAX);
+            }
+        }
+
+        if (dbl) {
+            switch (n->op) {
+                case TPlus:  a.sse(0xF2, 0x58, 0, 1); return true;
+                case TMinus: a.sse(0xF2, 0x5C, 0, 1); return true;
+                case TMult:  a.sse(0xF2, 0x59, 0, 1); return true;
+                case TDiv:   a.sse(0xF2, 0x5E, 0, 1); return true;
+                case TL:     a.sse(0x66, 0x2E, 1, 0); a.setcc(CondA, RAX); break;
+                case TLE:    a.sse(0x66, 0x2E, 1, 0); a.setcc(CondAE, RAX); break;
+                case TG:     a.sse(0x66, 0x2E, 0, 1); a.setcc(CondA, RAX); break;
+                case TGE:    a.sse(0x66, 0x2E, 0, 1); a.setcc(CondAE, RAX); break;
+                case TEq:
+                    a.sse(0x66, 0x2E, 0, 1);
+                    a.setcc(CondE, RAX);
+                    a.setcc(CondNP, RCX);
+                    a.byteOp(0x20);
+                    break;
+                case TNotEq:
+                    a.sse(0x66, 0x2E, 0, 1);
+                    a.setcc(CondNE, RAX);
+                    a.setcc(CondP, RCX);
+                    a.byteOp(0x08);
+                    break;
+                default:
+                    return false;
+            }
+            a.movzxAl();
+            return true;
+        }
+
+        switch (n->op) {
+            case TPlus:  a.rr(0x01, RAX, RCX); return true;
+            case TMinus: a.rr(0x29, RAX, RCX); return true;
+            case TMult:  a.imul(RAX, RCX); return true;
+            case TDiv:
+            case TMod:
+                // на -1 idiv переполняется для INT_MIN: как wrapDiv/wrapMod
+                if (unGroup(r)->value.asInt() == -1) {
+                    if (n->op == TDiv) a.unary(3, RAX);
+                    else a.rr(0x31, RAX, RAX);
+                    return true;
+                }
+                a.cdq();
+                a.unary(7, RCX);
+                if (n->op == TMod) a.rr(0x89, RAX, RDX);
+                return true;
+            case TL:     a.rr(0x39, RAX, RCX); a.setcc(CondL, RAX); break;
+            case TLE:    a.rr(0x39, RAX, RCX); a.setcc(CondLE, RAX); break;
+            case TG:     a.rr(0x39, RAX, RCX); a.setcc(CondG, RAX); break;
+            case TGE:    a.rr(0x39, RAX, RCX); a.setcc(CondGE, RAX); break;
+            case TEq:    a.rr(0x39, RAX, RCX); a.setcc(CondE, RAX); break;
+            case TNotEq: a.rr(0x39, RAX, RCX); a.setcc(CondNE, RAX); break;
+            default:
+                return false;
+        }
+        a.movzxAl();
+        return true;
+    }
+};
+
+// регистры записываемых ячеек цикла; rax, rcx, rdx, r8 - рабочие, r10 - счётчик
+constexpr Reg LoopGprs[] = {RBX, RBP, R12, R13, R14, R15, R9, R11};
+constexpr int LoopXmms = 14;    // xmm2..xmm15
+constexpr Reg Saved[] = {RBX, RBP, R12, R13, R14, R15};
+
+}  // namespace
+
+JitBuffer::~JitBuffer() {
+#ifdef JIT_X86_64
+    for (const auto& region : regions) {
+        munmap(region.first, region.second);
+    }
+#endif
+}
+
+void* JitBuffer::install(const std::vector<uint8_t>& code) {
+#ifdef JIT_X86_64
+    void* p = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(p, code.data(), code.size());
+    if (mprotect(p, code.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(p, code.size());
+        return nullptr;
+    }
+    regions.emplace_back(p, code.size());
+    return p;
+#else
+    (void)code;
+    return nullptr;
+#endif
+}
+
+// Проход: проверка условия, обновления по порядку с записью в log.
+bool JitBuffer::compileLoop(JitLoop& loop) {
+    if (!loop.cond) {
+        return false;
+    }
+
+    std::vector<int> regs(loop.cells.size(), -1);
+    size_t gprs = 0;
+    int xmms = 0;
+    for (size_t c = 0; c < loop.cells.size(); ++c) {
+        const JitLoop::Cell& cell = loop.cells[c];
+        if (!numeric(cell.type)) {
+            return false;
+        }
+        if (!cell.written) {
+            continue;
+        }
+        if (cell.type == DoubleType) {
+            if (xmms == LoopXmms) return false;
+            regs[c] = 2 + xmms++;
+        } else {
+            if (gprs == std::size(LoopGprs)) return false;
+            regs[c] = LoopGprs[gprs++];
+        }
+    }
+
+    Assembler a;
+    ExprCompiler expr{a, [&](const DesignatorSite* site, VarPlace& p) {
+        auto it = loop.cellOf.find(site);
+        if (it == loop.cellOf.end()) {
+            return false;
+        }
+        const uint32_t c = it->second;
+        if (regs[c] >= 0) {
+            p.kind = (loop.cells[c].type == DoubleType) ? VarPlace::InXmm : VarPlace::InGpr;
+            p.reg = regs[c];
+        } else {
+            p.kind = VarPlace::InFrame;
+            p.disp = static_cast<int32_t>(8 * c);
+        }
+        return true;
+    }};
+
+    uint32_t frame = static_cast<uint32_t>(loop.cells.size());
+    auto temps = [&](const CompiledExpr* e) {
+        expr.tempDisp = static_cast<int32_t>(8 * frame);
+        frame += e->tempCount;
+    };
+
+    for (Reg r : Saved) a.push(r);
+    a.push(RDX);
+    a.rr(0x31, R10, R10);
+    for (size_t c = 0; c < regs.size(); ++c) {
+        if (regs[c] < 0) continue;
+        if (loop.cells[c].type == DoubleType) a.loadsd(regs[c], RDI, static_cast<int32_t>(8 * c));
+        else a.load(regs[c], RDI, static_cast<int32_t>(8 * c));
+    }
+
+    std::vector<size_t> exits;
+    const size_t top = a.code.size();
+    a.cmpMem(R10, RSP, 0, true);
+    exits.push_back(a.jcc(CondAE));
+
+    temps(loop.cond);
+    if (!expr.value(loop.cond->root)) {
+        return false;
+    }
+    if (loop.cond->root->type == DoubleType) {
+        // истинно всё, кроме +-0; NaN - истина
+        a.sse(0x66, 0x57, 1, 1);
+        a.sse(0x66, 0x2E, 0, 1);
+        size_t unordered = a.jcc(CondP);
+        exits.push_back(a.jcc(CondE));
+        a.bind(unordered);
+    } else {
+        a.rr(0x85, RAX, RAX);
+        exits.push_back(a.jcc(CondE));
+    }
+
+    for (size_t j = 0; j < loop.updates.size(); ++j) {
+        const JitLoop::Update& u = loop.updates[j];
+        const int reg = regs[u.cell];
+        const bool dbl = (loop.cells[u.cell].type == DoubleType);
+        const bool minus = (u.op == TMinus || u.op == TDec);
+
+        if (!u.step) {
+            if (dbl) {
+                a.movImm64(RAX, std::bit_cast<uint64_t>(1.0));
+                a.movqToXmm(1, RAX);
+                a.sse(0xF2, minus ? 0x5C : 0x58, reg, 1);
+            } else {
+                a.imm(0, reg, minus ? -1 : 1);
+            }
+        } else {
+            const ExprNode* step = u.step->root;
+            // int-ячейке - только int-шаг: иначе присваивание печатает приведение
+            if (!dbl && step->type != IntType) {
+                return false;
+            }
+            temps(u.step);
+            if (!expr.value(step)) {
+                return false;
+            }
+            if (dbl) {
+                if (step->type == IntType) a.cvtsi2sd(0, RAX);
+                a.movsd(1, 0);
+                a.sse(0xF2, minus ? 0x5C : 0x58, reg, 1);
+            } else {
+                a.rr(minus ? 0x29 : 0x01, reg, RAX);
+            }
+        }
+
+        if (dbl) a.storesd(RSI, static_cast<int32_t>(8 * j), reg);
+        else a.store(RSI, static_cast<int32_t>(8 * j), reg);
+    }
+
+    a.imm(0, RSI, static_cast<int32_t>(8 * loop.updates.size()), true);
+    a.imm(0, R10, 1, true);
+    a.jmpBack(top);
+
+    for (size_t e : exits) a.bind(e);
+    for (size_t c = 0; c < regs.size(); ++c) {
+        if (regs[c] < 0) continue;
+        if (loop.cells[c].type == DoubleType) a.storesd(RDI, static_cast<int32_t>(8 * c), regs[c]);
+        else a.store(RDI, static_cast<int32_t>(8 * c), regs[c]);
+    }
+    a.rr(0x89, RAX, R10, true);
+    a.imm(0, RSP, 8, true);
+    for (size_t i = std::size(Saved); i-- > 0;) a.pop(Saved[i]);
+    a.ret();
+
+    loop.fn = reinterpret_cast<JitLoopFn>(install(a.code));
+    loop.frameSize = frame;
+    return loop.fn != nullptr;
+}
+
+bool JitBuffer::compileMethod(const CompiledExpr& body, JitMethod& method) {
+    Assembler a;
+    ExprCompiler expr{a, [&](const DesignatorSite* site, VarPlace& p) {
+        auto it = method.reads.find(site);
+        if (it == method.reads.end()) {
+            return false;
+        }
+        if (it->second.field) {
+            p.kind = VarPlace::InData;
+            p.disp = static_cast<int32_t>(8 * it->second.offset);
+        } else {
+            p.kind = VarPlace::AtAddress;
+            p.address = it->second.address;
+        }
+        return true;
+    }};
+    expr.tempBase = RSI;
+
+    if (!expr.value(body.root)) {
+        return false;
+    }
+    if (body.root->type == DoubleType) {
+        a.movqFromXmm(RAX, 0);
+    }
+    a.ret();
+
+    method.fn = reinterpret_cast<JitMethodFn>(install(a.code));
+    return method.fn != nullptr;
+}
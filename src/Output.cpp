@@ -0,0 +1,216 @@
+#include "Output.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <iterator>
+
+#include <unistd.h>
+
+namespace {
+
+constexpr int CrashSignals[] = {SIGSEGV, SIGFPE, SIGABRT, SIGBUS, SIGILL};
+constexpr size_t CrashStackSize = 64 * 1024;
+
+// вывод, который сбрасывается при сигнале; прежние обработчики и стек
+AsyncOutput* crashOutput = nullptr;
+struct sigaction savedActions[std::size(CrashSignals)];
+stack_t savedStack;
+std::unique_ptr<char[]> crashStack;
+
+}  // namespace
+
+SpscRing::SpscRing(size_t capacity) : bytes(new char[capacity]), mask(capacity - 1) {}
+
+size_t SpscRing::push(const char* data, size_t n) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    const size_t t = tail.load(std::memory_order_acquire);
+    n = std::min(n, mask + 1 - (h - t));
+
+    const size_t at = h & mask;
+    const size_t first = std::min(n, mask + 1 - at);
+    std::memcpy(bytes.get() + at, data, first);
+    std::memcpy(bytes.get(), data + first, n - first);
+
+    head.store(h + n, std::memory_order_release);
+    return n;
+}
+
+size_t SpscRing::readable(const char*& data) const {
+    return readableFrom(tail.load(std::memory_order_relaxed), data);
+}
+
+size_t SpscRing::readableFrom(size_t from, const char*& data) const {
+    const size_t h = head.load(std::memory_order_acquire);
+    const size_t at = from & mask;
+    data = bytes.get() + at;
+    return std::min(h - from, mask + 1 - at);
+}
+
+void SpscRing::pop(size_t n) {
+    tail.store(tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    tail.notify_all();
+}
+
+AsyncOutput::AsyncOutput(int fd)
+    : fd(fd), block(new char[BlockSize]), ring(RingSize), writer(&AsyncOutput::writeLoop, this) {
+    setp(block.get(), block.get() + BlockSize);
+}
+
+AsyncOutput::~AsyncOutput() {
+    close();
+}
+
+void AsyncOutput::close() {
+    restoreHandlers();
+    if (!writer.joinable()) {
+        return;
+    }
+    handOff();
+    closing.store(true, std::memory_order_release);
+    signal.fetch_add(1, std::memory_order_release);
+    signal.notify_one();
+    writer.join();
+}
+
+// блок основного потока - в кольцо; если оно заполнено, ждём читателя
+void AsyncOutput::handOff() {
+    const char* data = pbase();
+    size_t n = static_cast<size_t>(pptr() - pbase());
+    while (n > 0) {
+        const size_t pushed = ring.push(data, n);
+        data += pushed;
+        n -= pushed;
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_one();
+        if (n > 0) {
+            const size_t t = ring.tail.load(std::memory_order_acquire);
+            if (ring.head.load(std::memory_order_relaxed) - t == RingSize) {
+                ring.tail.wait(t, std::memory_order_acquire);
+            }
+        }
+    }
+    setp(block.get(), block.get() + BlockSize);
+}
+
+// ждём, пока фоновый поток запишет всё переданное
+void AsyncOutput::drain() {
+    const size_t target = ring.head.load(std::memory_order_relaxed);
+    for (size_t t = ring.tail.load(std::memory_order_acquire); t != target;
+         t = ring.tail.load(std::memory_order_acquire)) {
+        ring.tail.wait(t, std::memory_order_acquire);
+    }
+}
+
+AsyncOutput::int_type AsyncOutput::overflow(int_type ch) {
+    handOff();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize AsyncOutput::xsputn(const char* s, std::streamsize n) {
+    std::streamsize left = n;
+    while (left > 0) {
+        if (pptr() == epptr()) {
+            handOff();
+        }
+        const std::streamsize room = std::min<std::streamsize>(left, epptr() - pptr());
+        std::memcpy(pptr(), s, static_cast<size_t>(room));
+        pbump(static_cast<int>(room));
+        s += room;
+        left -= room;
+    }
+    return n;
+}
+
+// std::endl: строка остаётся в блоке
+int AsyncOutput::sync() {
+    return 0;
+}
+
+void AsyncOutput::flush() {
+    handOff();
+    drain();
+}
+
+void AsyncOutput::writeLoop() {
+    for (;;) {
+        const uint64_t seen = signal.load(std::memory_order_acquire);
+        const char* data = nullptr;
+        size_t n = ring.readable(data);
+        if (n > 0) {
+            writeAll(data, n);
+            ring.pop(n);
+            continue;
+        }
+        if (closing.load(std::memory_order_acquire) && ring.empty()) {
+            return;
+        }
+        signal.wait(seen, std::memory_order_acquire);
+    }
+}
+
+void AsyncOutput::writeAll(const char* data, size_t n) {
+    while (n > 0) {
+        const ssize_t written = ::write(fd, data, n);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;     // вывод закрыт: остаток отбрасывается
+        }
+        data += written;
+        n -= static_cast<size_t>(written);
+    }
+}
+
+// Обработчик на отдельном стеке (переполнение стека - тоже SIGSEGV).
+void AsyncOutput::flushOnCrash() {
+    crashStack.reset(new char[CrashStackSize]);
+    stack_t stack{};
+    stack.ss_sp = crashStack.get();
+    stack.ss_size = CrashStackSize;
+    sigaltstack(&stack, &savedStack);
+
+    struct sigaction action{};
+    action.sa_handler = &AsyncOutput::crashHandler;
+    action.sa_flags = SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < std::size(CrashSignals); ++i) {
+        sigaction(CrashSignals[i], &action, &savedActions[i]);
+    }
+    crashOutput = this;
+}
+
+void AsyncOutput::restoreHandlers() {
+    if (crashOutput != this) {
+        return;
+    }
+    crashOutput = nullptr;
+    for (size_t i = 0; i < std::size(CrashSignals); ++i) {
+        sigaction(CrashSignals[i], &savedActions[i], nullptr);
+    }
+    sigaltstack(&savedStack, nullptr);
+    crashStack.reset();
+}
+
+// Только write(2) и атомики. Кольцо читается от tail, не сдвигая его:
+// фоновый поток может писать тот же участок одновременно, тогда его
+// начало выйдет дважды, но ничего не потеряется.
+void AsyncOutput::crashHandler(int sig) {
+    AsyncOutput* out = crashOutput;
+    if (out) {
+        size_t from = out->ring.tail.load(std::memory_order_acquire);
+        const char* data = nullptr;
+        for (size_t n; (n = out->ring.readableFrom(from, data)) > 0; from += n) {
+            out->writeAll(data, n);
+        }
+        out->writeAll(out->pbase(), static_cast<size_t>(out->pptr() - out->pbase()));
+    }
+    // SA_RESETHAND вернул действие по умолчанию
+    raise(sig);
+}
@@ -1,11 +1,16 @@
 #include "Parser.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
 #include <iostream>
+#include <map>
 #include <stdexcept>
+#include <thread>
 
 static bool condToBool(const TData& v) {
-    if (v.dataType == TYPE_INT) return v.dataValue.dataAsInt != 0;
-    if (v.dataType == TYPE_DOUBLE) return v.dataValue.dataAsDouble != 0.0;
+    if (v.isInt()) return v.asInt() != 0;
+    if (v.isDouble()) return v.asDouble() != 0.0;
     return false;
 }
 
@@ -18,7 +23,10 @@ void Parser::setUK(uint32_t uk) {
     nextToken();
 }
 
-void Parser::debugFlag(const std::string& where) {
+void Parser::debugFlag(const char* where) {
+    if constexpr (!traces<TraceLevel::Events>) {
+        return;
+    }
     if (!flagInterpret) {
         return;
     }
@@ -28,92 +36,110 @@ void Parser::debugFlag(const std::string& where) {
               << std::endl;
 }
 
-void Parser::debugEvent(const std::string& msg) {
-    if (!flagInterpret) {
-        return;
+template <typename... Parts>
+void Parser::debugEvent(const Parts&... parts) {
+    if constexpr (traces<TraceLevel::Events>) {
+        if (!flagInterpret) {
+            return;
+        }
+        std::cout << "[DEBUG] ";
+        (std::cout << ... << parts) << std::endl;
     }
-    std::cout << "[DEBUG] " << msg << std::endl;
 }
 
 void Parser::resetExpr() {
     exprType = UndefinedType;
-    exprValue.dataType = TYPE_UNKNOWN;
-    exprValue.dataValue.dataAsInt = 0;
+    exprValue = TData();
 }
 
-void Parser::printAssignment(const Node* dest, const std::string& fullName) {
-    if (!dest) {
-        return;
-    }
-    const std::string& name = fullName.empty() ? dest->id : fullName;
-    std::cout << name << " = ";
-    switch (dest->data.dataType) {
+// Значение как при выводе в std::cout (double - %g с 6 знаками), через
+// std::to_chars без потока.
+static void appendValue(std::string& out, const TData& value) {
+    char buf[32];
+    std::to_chars_result r{buf, {}};
+    switch (value.type()) {
         case TYPE_INT:
-            std::cout << dest->data.dataValue.dataAsInt;
+            r = std::to_chars(buf, buf + sizeof buf, value.asInt());
             break;
         case TYPE_DOUBLE:
-            std::cout << dest->data.dataValue.dataAsDouble;
+            r = std::to_chars(buf, buf + sizeof buf, value.asDouble(), std::chars_format::general, 6);
             break;
         default:
-            std::cout << "";
             break;
     }
-    std::cout << std::endl;
+    out.append(buf, r.ptr);
 }
 
-void Parser::assignValue(Node* dest, PrimitiveDataType destType, const TData& srcValue) {
-    if (!dest) {
+// Строка собирается в lineText и пишется одним вызовом; без сброса потока,
+// его выполняет сам вывод (AsyncOutput) или вывод в std::cerr.
+// С журналом событий вместо строки - запись в журнал.
+void Parser::printAssignment(uint32_t nameId, const TData& value) {
+    if (events) {
+        events->assign(nameId, value);
         return;
     }
+    lineText.assign(NameTable::Get(nameId));
+    lineText += " = ";
+    appendValue(lineText, value);
+    lineText += '\n';
+    std::cout.write(lineText.data(), static_cast<std::streamsize>(lineText.size()));
+}
 
-    switch (destType) {
-        case IntType:
-            dest->data.dataType = TYPE_INT;
-            if (srcValue.dataType == TYPE_INT) {
-                dest->data.dataValue.dataAsInt = srcValue.dataValue.dataAsInt;
-            } else if (srcValue.dataType == TYPE_DOUBLE) {
-                std::cout << "приведение типа (double -> int) при присваивании '"
-                          << dest->id << "'" << std::endl;
-                dest->data.dataValue.dataAsInt =
-                    static_cast<int>(srcValue.dataValue.dataAsDouble);
-            } else {
-                dest->data.dataValue.dataAsInt = 0;
-            }
-            break;
+// Значение под числовой тип type; значение другого типа приводится с
+// сообщением, в котором name - принимающая переменная или метод.
+static TData convertValue(const std::string& name, PrimitiveDataType type, const TData& value) {
+    if (type == IntType) {
+        if (value.isInt()) {
+            return value;
+        }
+        if (value.isDouble()) {
+            std::cout << "приведение типа (double -> int) при присваивании '" << name << "'\n";
+            return TData::Int(static_cast<int>(value.asDouble()));
+        }
+        return TData::Int(0);
+    }
 
-        case DoubleType:
-            dest->data.dataType = TYPE_DOUBLE;
-            if (srcValue.dataType == TYPE_DOUBLE) {
-                dest->data.dataValue.dataAsDouble = srcValue.dataValue.dataAsDouble;
-            } else if (srcValue.dataType == TYPE_INT) {
-                std::cout << "приведение типа (int -> double) при присваивании '"
-                          << dest->id << "'" << std::endl;
-                dest->data.dataValue.dataAsDouble =
-                    static_cast<double>(srcValue.dataValue.dataAsInt);
-            } else {
-                dest->data.dataValue.dataAsDouble = 0.0;
-            }
-            break;
+    if (value.isDouble()) {
+        return value;
+    }
+    if (value.isInt()) {
+        std::cout << "приведение типа (int -> double) при присваивании '" << name << "'\n";
+        return TData::Double(static_cast<double>(value.asInt()));
+    }
+    return TData::Double(0.0);
+}
 
-        default:
-            dest->data.dataType = TYPE_UNKNOWN;
-            break;
+// decl - объявление (имя для сообщений, признак инициализации),
+// dest - ячейка значения: данные узла переменной или поле в блоке объекта
+void Parser::assignValue(Node* decl, TData& dest, PrimitiveDataType destType, const TData& srcValue) {
+    if (!decl) {
+        return;
     }
 
-    dest->isInitialized = true;
+    if (destType == IntType || destType == DoubleType) {
+        dest = convertValue(decl->id(), destType, srcValue);
+    } else {
+        dest.retag(TYPE_UNKNOWN);
+    }
+
+    decl->isInitialized = true;
 }
 
+template <TraceLevel Level>
 void Parser::debugValue(const char* label, const TData& v, PrimitiveDataType t) {
+    if constexpr (!traces<Level>) {
+        return;
+    }
     if (!flagInterpret) {
         return;
     }
     std::cout << label << ": ";
-    switch (v.dataType) {
+    switch (v.type()) {
         case TYPE_INT:
-            std::cout << v.dataValue.dataAsInt << " (int)";
+            std::cout << v.asInt() << " (int)";
             break;
         case TYPE_DOUBLE:
-            std::cout << v.dataValue.dataAsDouble << " (double)";
+            std::cout << v.asDouble() << " (double)";
             break;
         default:
             std::cout << "";
@@ -124,180 +150,1231 @@ void Parser::debugValue(const char* label, const TData& v, PrimitiveDataType t)
     } else if (t == DoubleType) {
         std::cout << " [DoubleType]";
     }
-    std::cout << std::endl;
-}
+    std::cout << std::endl;
+}
+
+static const char* opName(uint16_t token) {
+    switch (token) {
+        case TPlus:   return "+";
+        case TMinus:  return "-";
+        case TMult:   return "*";
+        case TDiv:    return "/";
+        case TMod:    return "%";
+        case TL:      return "<";
+        case TG:      return ">";
+        case TLE:     return "<=";
+        case TGE:     return ">=";
+        case TEq:     return "==";
+        case TNotEq:  return "!=";
+        default:      return "?";
+    }
+}
+
+// Операция выбирается по статическим типам операндов, теги значений
+// при вычислении не проверяются.
+TData Parser::evalBinary(uint16_t op,
+                         const TData& l, PrimitiveDataType lt,
+                         const TData& r, PrimitiveDataType rt,
+                         PrimitiveDataType& resultType) {
+    if (isCompareOp(op)) {
+        resultType = IntType;
+    } else {
+        resultType = (lt == DoubleType || rt == DoubleType) ? DoubleType : IntType;
+    }
+
+    // В режиме проектирования значения не вычисляем и отладку не печатаем.
+    if (!flagInterpret) {
+        return (resultType == DoubleType) ? makeData<double>(0.0) : makeData<int>(0);
+    }
+
+    return runBinary(op, binaryFn(op, lt, rt), l, r);
+}
+
+TData Parser::runBinary(uint16_t op, BinaryFn fn, const TData& l, const TData& r) {
+    constexpr bool trace = traces<TraceLevel::Ops>;
+    if constexpr (trace) {
+        std::cout << "[DEBUG] Операция: ";
+        if (l.isInt()) std::cout << l.asInt() << " (int) ";
+        else if (l.isDouble()) std::cout << l.asDouble() << " (double) ";
+
+        std::cout << opName(op) << " ";
+
+        if (r.isInt()) std::cout << r.asInt() << " (int) ";
+        else if (r.isDouble()) std::cout << r.asDouble() << " (double) ";
+    }
+
+    if (!fn) {
+        std::cerr << "Semantic error: unknown binary operation" << std::endl;
+        if constexpr (trace) {
+            std::cout << " -> 0 (int)" << std::endl;
+        }
+        return makeData<int>(0);
+    }
+
+    // предупреждения (деление на ноль и т.п.) печатаются внутри fn
+    TData res = fn(l, r);
+
+    if constexpr (trace) {
+        if (isCompareOp(op)) {
+            std::cout << " -> " << res.asInt() << " (int, compare)" << std::endl;
+        } else if (res.isDouble()) {
+            std::cout << " -> " << res.asDouble() << " (double)" << std::endl;
+        } else {
+            std::cout << " -> " << res.asInt() << " (int)" << std::endl;
+        }
+    }
+    return res;
+}
+
+ExprNode* Parser::newExprNode(ExprKind kind, PrimitiveDataType type) {
+    exprNodes.emplace_back();
+    ExprNode* n = &exprNodes.back();
+    n->kind = kind;
+    n->type = type;
+    return n;
+}
+
+// значение узла, известное при анализе: литерал или выражение в скобках над ним
+static const TData* foldedValue(const ExprNode* n) {
+    while (n->kind == ExprGroup) {
+        n = n->left;
+    }
+    return n->kind == ExprConst ? &n->value : nullptr;
+}
+
+// операция не печатает предупреждений: деление и остаток - только
+// на ненулевую константу, остаток от double не допускается
+static bool silentOp(const ExprNode* n) {
+    if (n->op != TDiv && n->op != TMod) {
+        return true;
+    }
+    if (n->op == TMod && (n->left->type == DoubleType || n->right->type == DoubleType)) {
+        return false;
+    }
+    const TData* r = foldedValue(n->right);
+    if (!r) {
+        return false;
+    }
+    return (n->right->type == DoubleType) ? r->asDouble() != 0.0
+                                          : r->asInt() != 0;
+}
+
+// Операции, печатающие предупреждение или падающие, оставляются до выполнения.
+static bool foldable(uint16_t op, const TData& l, PrimitiveDataType lt,
+                     const TData& r, PrimitiveDataType rt) {
+    if (op != TDiv && op != TMod) {
+        return true;
+    }
+    if (lt == DoubleType || rt == DoubleType) {
+        double rv = (rt == DoubleType) ? r.asDouble() : r.asInt();
+        return op == TDiv && rv != 0.0;
+    }
+    if (r.asInt() == 0) {
+        return false;
+    }
+    return !(l.asInt() == INT32_MIN && r.asInt() == -1);
+}
+
+// Свёртка констант: операция над литералами и глобальными константами
+// вычисляется один раз той же специализированной функцией.
+ExprNode* Parser::binaryNode(uint16_t op, ExprNode* l, ExprNode* r,
+                             PrimitiveDataType resType, bool traceStep) {
+    BinaryFn fn = binaryFn(op, l->type, r->type);
+
+    const TData* lv = foldedValue(l);
+    const TData* rv = foldedValue(r);
+    if (options.optimize && fn && lv && rv && foldable(op, *lv, l->type, *rv, r->type)) {
+        ExprNode* n = newExprNode(ExprConst, resType);
+        n->value = fn(*lv, *rv);
+        return n;
+    }
+
+    ExprNode* n = newExprNode(ExprBinary, resType);
+    n->op = op;
+    n->traceStep = traceStep;
+    n->fn = fn;
+    n->left = l;
+    n->right = r;
+
+    // предупреждение - видимый эффект, такой метод не запоминается
+    if (!silentOp(n)) {
+        markImpure();
+    }
+    return n;
+}
+
+static uint64_t cellRoot(const DesignatorSite& site) {
+    if (site.frameSlot != Node::NoSlot) {
+        return (uint64_t(1) << 63) | site.frameSlot;
+    }
+    return reinterpret_cast<uintptr_t>(site.root);
+}
+
+static uint32_t cellOffset(const DesignatorSite& site) {
+    return site.member ? site.memberOffset : LoopInfo::WholeRoot;
+}
+
+// размер дерева для порога встраивания; тела с вызовами не встраиваются
+static uint32_t inlineCost(const ExprNode* n) {
+    if (!n) {
+        return 0;
+    }
+    if (n->kind == ExprCall || n->kind == ExprInline) {
+        return UINT32_MAX;
+    }
+    uint32_t l = inlineCost(n->left);
+    uint32_t r = inlineCost(n->right);
+    if (l == UINT32_MAX || r == UINT32_MAX) {
+        return UINT32_MAX;
+    }
+    return 1 + l + r;
+}
+
+// значение ячейки как левый операнд составного присваивания
+static TData loadAs(const TData& place, PrimitiveDataType t) {
+    if (t == DoubleType) {
+        if (place.isDouble()) return makeData<double>(place.asDouble());
+        if (place.isInt()) return makeData<double>(static_cast<double>(place.asInt()));
+        return makeData<double>(0.0);
+    }
+    if (place.isInt()) return makeData<int>(place.asInt());
+    if (place.isDouble()) return makeData<int>(static_cast<int>(place.asDouble()));
+    return makeData<int>(0);
+}
+
+// a op b  <=>  b mirror(op) a; то же для ~a, ~b (~ обращает порядок int)
+static uint16_t mirrorCompare(uint16_t op) {
+    switch (op) {
+        case TL:  return TG;
+        case TG:  return TL;
+        case TLE: return TGE;
+        case TGE: return TLE;
+        default:  return op;
+    }
+}
+
+// Первое значение последовательности start, start + 1, ... (по модулю 2^32),
+// на котором сравнение с b ложно. false - такого значения нет.
+static bool firstFalse(int32_t start, int32_t b, uint16_t op, int32_t& stop) {
+    switch (op) {
+        case TL:
+            stop = (start >= b) ? start : b;
+            return true;
+        case TLE:
+            if (start > b) { stop = start; return true; }
+            if (b == INT32_MAX) return false;
+            stop = b + 1;
+            return true;
+        case TG:
+            // после INT32_MAX значение переходит в INT32_MIN <= b
+            stop = (start <= b) ? start : INT32_MIN;
+            return true;
+        case TGE:
+            if (start < b) { stop = start; return true; }
+            if (b == INT32_MIN) return false;
+            stop = INT32_MIN;
+            return true;
+        case TEq:
+            stop = (start != b) ? start : static_cast<int32_t>(static_cast<uint32_t>(start) + 1);
+            return true;
+        case TNotEq:
+            stop = b;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// проходов цикла-редукции за один запуск потоков и строк вывода в одной части
+static constexpr uint32_t ReductionBlock = 1u << 14;
+static constexpr uint32_t ReductionLines = 1024;
+
+// проходов цикла за один вызов машинного кода
+static constexpr uint32_t JitBlock = 1u << 12;
+
+static bool compareInt(uint16_t op, int64_t a, int64_t b) {
+    switch (op) {
+        case TL:  return a < b;
+        case TG:  return a > b;
+        case TLE: return a <= b;
+        case TGE: return a >= b;
+        case TEq: return a == b;
+        default:  return a != b;
+    }
+}
+
+namespace {
+
+// Инвариантность подвыражений относительно записей одного цикла.
+struct InvariantScan {
+    const LoopInfo& loop;
+    std::unordered_map<const ExprNode*, bool> invariant;
+    std::unordered_map<const ExprNode*, bool> clean;     // нет сохранений во временные
+
+    bool killed(const DesignatorSite& site) const {
+        if (site.frameSlot == Node::NoSlot && loop.hasCall) {
+            return true;
+        }
+        uint64_t root = cellRoot(site);
+        uint32_t offset = cellOffset(site);
+
+        auto it = loop.writes.lower_bound({root, 0});
+        if (it == loop.writes.end() || it->first != root) {
+            return false;
+        }
+        return offset == LoopInfo::WholeRoot ||
+               loop.writes.count({root, offset}) ||
+               loop.writes.count({root, LoopInfo::WholeRoot});
+    }
+
+    bool scan(const ExprNode* n) {
+        bool inv = false;
+        bool cl = (n->temp == ExprNode::NoTemp);
+        switch (n->kind) {
+            case ExprConst:
+                inv = true;
+                break;
+            case ExprVar:
+                inv = !killed(*n->site);
+                break;
+            case ExprNeg:
+            case ExprGroup:
+                inv = scan(n->left);
+                cl = cl && clean[n->left];
+                break;
+            case ExprBinary: {
+                bool l = scan(n->left);
+                bool r = scan(n->right);
+                inv = l && r && silentOp(n);
+                cl = cl && clean[n->left] && clean[n->right];
+                break;
+            }
+            default:
+                break;
+        }
+        invariant[n] = inv;
+        clean[n] = cl;
+        return inv;
+    }
+
+    bool childrenClean(const ExprNode* n) {
+        return (!n->left || clean[n->left]) && (!n->right || clean[n->right]);
+    }
+};
+
+}  // namespace
+
+// Шаг накопителя допускает вычисление вне порядка: нет вызовов, ++/--,
+// предупреждений и чтений ячеек, которые пишет цикл (кроме счётчика).
+static bool reductionStep(const ExprNode* n, uint32_t counterSlot, const InvariantScan& scan) {
+    switch (n->kind) {
+        case ExprConst:
+        case ExprTemp:
+            return true;
+        case ExprVar:
+            return (n->site->frameSlot == counterSlot && !n->site->member) || !scan.killed(*n->site);
+        case ExprNeg:
+        case ExprGroup:
+            return reductionStep(n->left, counterSlot, scan);
+        case ExprBinary:
+            return n->fn && silentOp(n) && reductionStep(n->left, counterSlot, scan) &&
+                   reductionStep(n->right, counterSlot, scan);
+        default:
+            return false;
+    }
+}
+
+// Выносятся наибольшие инвариантные подвыражения: значение вычисляется при
+// первом обращении в проходе цикла и далее берётся из ячейки.
+void Parser::hoistInvariants(uint32_t loopId) {
+    InvariantScan scan{loops[loopId], {}, {}};
+
+    std::vector<ExprNode*> work;
+    for (ExprNode* root : loops[loopId].exprs) {
+        scan.scan(root);
+        work.push_back(root);
+    }
+
+    while (!work.empty()) {
+        ExprNode* n = work.back();
+        work.pop_back();
+
+        bool worth = (n->kind == ExprBinary || n->kind == ExprNeg);
+        if (worth && scan.invariant[n] && scan.childrenClean(n)) {
+            if (n->hoist == UINT32_MAX) {
+                n->hoist = static_cast<uint32_t>(hoistSlots.size());
+                hoistSlots.emplace_back();
+            }
+            // внешний цикл, для которого значение тоже инвариантно, выигрывает
+            hoistSlots[n->hoist].loop = loopId;
+            continue;
+        }
+        // тело встроенного метода общее для всех мест вызова
+        if (n->kind == ExprInline) continue;
+        if (n->left) work.push_back(n->left);
+        if (n->right) work.push_back(n->right);
+    }
+}
+
+// Оператор тела v += e, v -= e, ++v, v++ (stepPos - позиция e или UINT32_MAX).
+// Записывается только при первом разборе тела цикла.
+void Parser::noteUpdate(const DesignatorSite* site, uint16_t op, uint32_t stepPos) {
+    LoopInfo::Update update;
+    update.site = site;
+    update.op = op;
+    if (stepPos != UINT32_MAX) {
+        auto step = exprCache.find(stepPos);
+        if (step == exprCache.end()) {
+            noteComplexStatement();
+            return;
+        }
+        update.step = &step->second;
+        update.stepType = step->second.root->type;
+    }
+    for (uint32_t loopId : loopStack) {
+        if (!loops[loopId].bodySeen) {
+            loops[loopId].updates.push_back(update);
+        }
+    }
+}
+
+// объявления, присваивания, вызовы, return и вложенные циклы разбираются как обычно
+void Parser::noteComplexStatement() {
+    for (uint32_t loopId : loopStack) {
+        loops[loopId].onlyUpdates = false;
+    }
+}
+
+// После первого разбора тела: цикл без вызовов из одних обновлений
+// выполняется напрямую по построенным деревьям.
+void Parser::classifyLoop(uint32_t loopId, uint32_t condPos) {
+    LoopInfo& loop = loops[loopId];
+    loop.bodySeen = true;
+    loop.endPos = scanner->getTokenStartPos();
+
+    auto cond = exprCache.find(condPos);
+    if (!options.optimize || cond == exprCache.end()) {
+        return;
+    }
+    loop.cond = &cond->second;
+
+    const ExprNode* c = loop.cond->root;
+    while (c->kind == ExprGroup) {
+        c = c->left;
+    }
+
+    if (c->kind == ExprConst && !condToBool(c->value)) {
+        loop.never = true;
+        return;
+    }
+
+    // заголовок из одного сравнения: переход по значениям операндов
+    auto plain = [](const ExprNode* n) {
+        return n->kind == ExprConst || n->kind == ExprVar;
+    };
+    if (c->kind == ExprBinary && isCompareOp(c->op) && plain(c->left) && plain(c->right)) {
+        loop.test = compareFn(c->op, c->left->type, c->right->type);
+        loop.testLeft = c->left;
+        loop.testRight = c->right;
+    }
+
+    if (!loop.onlyUpdates || loop.hasCall) {
+        return;
+    }
+    loop.direct = true;
+
+    InvariantScan scan{loop, {}, {}};
+    uint32_t bodySize = 0;
+    for (LoopInfo::Update& u : loop.updates) {
+        u.invariant = u.step && scan.scan(u.step->root);
+        bodySize += 1 + (u.step ? inlineCost(u.step->root) : 0);
+    }
+
+    if (c->kind != ExprBinary || !isCompareOp(c->op) ||
+        c->left->type != IntType || c->right->type != IntType) {
+        return;
+    }
+
+    // без тела: условие вида i++ < n или n > --i над int;
+    // с телом: i < n над локальной int, которая меняется на постоянный шаг
+    const bool closedForm = loop.updates.empty();
+    auto counterKind = [closedForm](const ExprNode* n) {
+        if (closedForm) {
+            return n->kind == ExprPreInc || n->kind == ExprPostInc;
+        }
+        return n->kind == ExprVar && n->site->frameSlot != Node::NoSlot && !n->site->member;
+    };
+
+    const ExprNode* counter = c->left;
+    const ExprNode* bound = c->right;
+    uint16_t rel = c->op;
+    if (!counterKind(counter)) {
+        std::swap(counter, bound);
+        rel = mirrorCompare(rel);
+    }
+    if (!counterKind(counter) || !scan.scan(bound)) {
+        return;
+    }
+
+    if (!loop.updates.empty()) {
+        bool stepped = false;
+        bool reduction = true;
+        for (const LoopInfo::Update& u : loop.updates) {
+            if (u.site->frameSlot != counter->site->frameSlot || u.site->member) {
+                // накопитель: локальная ячейка, шаг зависит только от счётчика и инвариантов
+                reduction = reduction && u.site->frameSlot != Node::NoSlot && u.step &&
+                            (u.site->type == DoubleType || u.stepType == IntType) &&
+                            reductionStep(u.step->root, counter->site->frameSlot, scan);
+                continue;
+            }
+            if (u.step && !(u.invariant && u.stepType == IntType)) {
+                return;
+            }
+            stepped = true;
+        }
+        if (!stepped || rel == TEq) {
+            return;
+        }
+        loop.unroll = options.unroll ? options.unroll : std::clamp(32u / bodySize, 2u, 8u);
+        loop.reduction = reduction;
+    }
+
+    loop.counter = counter;
+    loop.bound = bound;
+    loop.rel = rel;
+}
+
+// Итоговое значение счётчика цикла без тела; промежуточные значения
+// ничего не печатают. false - цикл не завершается, выполняется как есть.
+bool Parser::runClosedForm(const LoopInfo& loop) {
+    const DesignatorSite& site = *loop.counter->site;
+    Tree* root = resolveSite(site);
+    TData* place = root ? sitePlace(site, root) : nullptr;
+    if (!place) {
+        return false;
+    }
+
+    int32_t b = evalRoot(loop.bound, loop.cond->tempCount).asInt();
+    int32_t cur = place->isInt() ? place->asInt() : 0;
+
+    const bool up = (loop.counter->op == TInc);
+    const bool postfix = (loop.counter->kind == ExprPostInc);
+    auto advance = [up](int32_t v) {
+        return static_cast<int32_t>(static_cast<uint32_t>(v) + (up ? 1u : UINT32_MAX));
+    };
+
+    // сравниваемые значения: старые (i++) или новые (++i)
+    int32_t start = postfix ? cur : advance(cur);
+    int32_t stop = 0;
+    if (up) {
+        if (!firstFalse(start, b, loop.rel, stop)) return false;
+    } else {
+        if (!firstFalse(~start, ~b, mirrorCompare(loop.rel), stop)) return false;
+        stop = ~stop;
+    }
+
+    touch(&site);
+    Node* decl = (site.member ? site.member : root)->getNode();
+    assignValue(decl, *place, IntType, makeData<int>(postfix ? advance(stop) : stop));
+    return true;
+}
+
+// Операнд сравнения в заголовке цикла: литерал или ячейка designator'а.
+const TData& Parser::testOperand(const ExprNode* n) {
+    if (n->kind == ExprConst) {
+        return n->value;
+    }
+    Tree* root = resolveSite(*n->site);
+    TData* place = root ? sitePlace(*n->site, root) : nullptr;
+    if (!place) {
+        throw std::runtime_error("Семантическая ошибка");
+    }
+    return *place;
+}
+
+bool Parser::loopCondition(const LoopInfo& loop) {
+    if (loop.test) {
+        return loop.test(testOperand(loop.testLeft), testOperand(loop.testRight));
+    }
+    return condToBool(evalRoot(loop.cond->root, loop.cond->tempCount));
+}
+
+// Условие и правые части вычисляются по деревьям, обновления - теми же
+// операциями, что и в Statement; печать присваиваний сохраняется.
+void Parser::runDirectLoop(uint32_t loopId) {
+    LoopInfo& loop = loops[loopId];
+    if (loop.counter && loop.updates.empty() && runClosedForm(loop)) {
+        setUK(loop.endPos);
+        return;
+    }
+
+    struct Target {
+        TData* place;
+        Node* decl;
+        TData step;
+        bool ready;
+    };
+    std::vector<Target> targets;
+    targets.reserve(loop.updates.size());
+    for (const LoopInfo::Update& u : loop.updates) {
+        Tree* root = resolveSite(*u.site);
+        TData* place = root ? sitePlace(*u.site, root) : nullptr;
+        if (!place) {
+            throw std::runtime_error("Семантическая ошибка");
+        }
+        targets.push_back({place, (u.site->member ? u.site->member : root)->getNode(), TData(), false});
+    }
+
+    auto body = [&]() {
+        if (events) {
+            events->loop(loopId);
+        }
+        for (size_t i = 0; i < targets.size(); ++i) {
+            const LoopInfo::Update& u = loop.updates[i];
+            Target& t = targets[i];
+            const DesignatorSite& site = *u.site;
+
+            if (!u.step) {
+                touch(&site);
+                (void)stepPlace(t.decl, *t.place, site.type, u.op, false);
+                printAssignment(site.nameId, *t.place);
+                continue;
+            }
+
+            if (!u.invariant || !t.ready) {
+                t.step = evalRoot(u.step->root, u.step->tempCount);
+                t.ready = true;
+            }
+            PrimitiveDataType resType;
+            TData res = evalBinary(u.op, loadAs(*t.place, site.type), site.type,
+                                   t.step, u.stepType, resType);
+            touch(&site);
+            assignValue(t.decl, *t.place, site.type, res);
+            printAssignment(site.nameId, *t.place);
+        }
+    };
+
+    // Развёртка: за проход счётчик меняется на d. Если условие истинно на
+    // первом и последнем из unroll значений и счётчик не переполняется,
+    // оно истинно на всех - тело выполняется unroll раз без проверок.
+    int64_t d = 0;
+    int64_t bound = 0;
+    const TData* counter = nullptr;
+    std::vector<int64_t> deltas(targets.size(), 0);
+    if (loop.counter && !loop.updates.empty()) {
+        bound = evalRoot(loop.bound, loop.cond->tempCount).asInt();
+        counter = sitePlace(*loop.counter->site, resolveSite(*loop.counter->site));
+
+        bool sameSign = true;
+        for (size_t i = 0; i < targets.size(); ++i) {
+            const LoopInfo::Update& u = loop.updates[i];
+            if (u.site->frameSlot != loop.counter->site->frameSlot || u.site->member) {
+                continue;
+            }
+            int64_t delta = 1;
+            if (u.step) {
+                targets[i].step = evalRoot(u.step->root, u.step->tempCount);
+                targets[i].ready = true;
+                delta = targets[i].step.asInt();
+            }
+            if (u.op == TDec || u.op == TMinus) {
+                delta = -delta;
+            }
+            deltas[i] = delta;
+            sameSign = sameSign && (delta == 0 || d == 0 || (delta > 0) == (d > 0));
+            d += delta;
+        }
+        if (!sameSign) {
+            d = 0;
+        }
+    }
+
+    // условие истинно на всех count следующих проходах
+    auto provable = [&](int64_t count) {
+        int64_t cur = counter->isInt() ? counter->asInt() : 0;
+        int64_t last = cur + (count - 1) * d;
+        int64_t after = cur + count * d;
+        if (after > INT32_MAX || after < INT32_MIN) {
+            return false;
+        }
+        if (loop.rel == TNotEq) {
+            return (bound < std::min(cur, last)) || (bound > std::max(cur, last));
+        }
+        return compareInt(loop.rel, cur, bound) && compareInt(loop.rel, last, bound);
+    };
+
+    unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    std::vector<TData*> places;
+    for (const Target& t : targets) {
+        places.push_back(t.place);
+    }
+
+    while (true) {
+        if (d != 0 && loop.reduction && threads > 1 && provable(ReductionBlock)) {
+            runReductionBlock(loop, places, deltas, d, ReductionBlock, threads);
+            continue;
+        }
+        if (loop.jit.fn) {
+            bool finished = false;
+            if (runJitBlock(loop, finished)) {
+                if (finished) break;
+                continue;
+            }
+        }
+        if (d != 0 && loop.unroll > 1 && provable(loop.unroll)) {
+            for (uint32_t k = 0; k < loop.unroll; ++k) {
+                body();
+            }
+            loop.runs += loop.unroll;
+        } else {
+            if (!loopCondition(loop)) {
+                break;
+            }
+            body();
+            loop.runs++;
+        }
+        if (options.jit && !loop.jitTried && loop.runs >= options.jit) {
+            jitLoop(loop);
+        }
+    }
+    setUK(loop.endPos);
+}
+
+// Ячейки цикла - по корню и смещению, как в анализе записей: разные
+// designator'ы одной ячейки получают один регистр.
+void Parser::jitLoop(LoopInfo& loop) {
+    loop.jitTried = true;
+    JitLoop& jit = loop.jit;
+    jit.cond = loop.cond;
+
+    bool typed = true;
+    std::map<std::pair<uint64_t, uint32_t>, uint32_t> keys;
+    auto cell = [&](const DesignatorSite* site, bool written) {
+        auto key = std::make_pair(cellRoot(*site), cellOffset(*site));
+        auto it = keys.find(key);
+        if (it == keys.end()) {
+            it = keys.emplace(key, static_cast<uint32_t>(jit.cells.size())).first;
+            jit.cells.push_back({site, site->type, false});
+        }
+        JitLoop::Cell& c = jit.cells[it->second];
+        c.written = c.written || written;
+        typed = typed && c.type == site->type;
+        jit.cellOf[site] = it->second;
+        return it->second;
+    };
+
+    std::vector<const ExprNode*> work{loop.cond->root};
+    for (const LoopInfo::Update& u : loop.updates) {
+        jit.updates.push_back({cell(u.site, true), u.op, u.step});
+        if (u.step) {
+            work.push_back(u.step->root);
+        }
+    }
+    while (!work.empty()) {
+        const ExprNode* e = work.back();
+        work.pop_back();
+        if (e->kind == ExprVar) {
+            cell(e->site, false);
+        }
+        if (e->left) work.push_back(e->left);
+        if (e->right) work.push_back(e->right);
+    }
+
+    if (!typed || !jitCode.compileLoop(jit)) {
+        jit.fn = nullptr;
+    }
+}
+
+// Блок проходов в машинном коде. Ячейки передаются значениями своего
+// типа, присваивания печатаются после блока в исходном порядке.
+// false - ячейки не того типа или совпадают, блок выполняет интерпретатор.
+bool Parser::runJitBlock(const LoopInfo& loop, bool& finished) {
+    const JitLoop& jit = loop.jit;
+    std::vector<TData*> places(jit.cells.size());
+    std::vector<int64_t> frame(jit.frameSize);
+    for (size_t c = 0; c < jit.cells.size(); ++c) {
+        const JitLoop::Cell& cell = jit.cells[c];
+        Tree* root = resolveSite(*cell.site);
+        TData* place = root ? sitePlace(*cell.site, root) : nullptr;
+        const bool dbl = (cell.type == DoubleType);
+        if (!place || place->type() != (dbl ? TYPE_DOUBLE : TYPE_INT)) {
+            return false;
+        }
+        places[c] = place;
+        frame[c] = dbl ? std::bit_cast<int64_t>(place->asDouble()) : place->asInt();
+    }
+    std::vector<TData*> distinct = places;
+    std::sort(distinct.begin(), distinct.end());
+    if (std::adjacent_find(distinct.begin(), distinct.end()) != distinct.end()) {
+        return false;
+    }
+
+    const size_t n = jit.updates.size();
+    std::vector<int64_t> log(n * JitBlock);
+    const uint64_t done = jit.fn(frame.data(), log.data(), JitBlock);
+    finished = (done < JitBlock);
+    if (done == 0) {
+        return true;
+    }
+
+    lineText.clear();
+    for (uint64_t k = 0; k < done; ++k) {
+        if (events) {
+            events->loop(static_cast<uint32_t>(&loop - loops.data()));
+        }
+        for (size_t j = 0; j < n; ++j) {
+            const int64_t v = log[k * n + j];
+            const TData value = jit.cells[jit.updates[j].cell].type == DoubleType
+                                    ? TData::Double(std::bit_cast<double>(v))
+                                    : TData::Int(static_cast<int>(v));
+            if (events) {
+                events->assign(loop.updates[j].site->nameId, value);
+                continue;
+            }
+            lineText += loop.updates[j].site->fullName;
+            lineText += " = ";
+            appendValue(lineText, value);
+            lineText += '\n';
+        }
+    }
+    std::cout.write(lineText.data(), static_cast<std::streamsize>(lineText.size()));
+
+    for (size_t j = 0; j < n; ++j) {
+        const DesignatorSite& site = *loop.updates[j].site;
+        const uint32_t c = jit.updates[j].cell;
+        Tree* root = resolveSite(site);
+        Node* decl = (site.member ? site.member : root)->getNode();
+        TData value = (jit.cells[c].type == DoubleType)
+                          ? TData::Double(std::bit_cast<double>(frame[c]))
+                          : TData::Int(static_cast<int>(frame[c]));
+        touch(&site);
+        assignValue(decl, *places[c], site.type, value);
+    }
+    return true;
+}
+
+namespace {
+
+// Шаг накопителя, вычисляемый в потоке: без печати и без общих ячеек.
+// Читает счётчик и инвариантные ячейки, значения которых сняты заранее.
+struct QuietEval {
+    uint32_t counterSlot;
+    const std::unordered_map<const ExprNode*, TData>& fixed;
+    std::vector<TData> temps;
+
+    TData eval(const ExprNode* n, int counter) {
+        TData v;
+        switch (n->kind) {
+            case ExprTemp:
+                return temps[n->temp];
+            case ExprConst:
+                v = n->value;
+                break;
+            case ExprVar:
+                v = (n->site->frameSlot == counterSlot && !n->site->member) ? TData::Int(counter)
+                                                                          : fixed.at(n);
+                break;
+            case ExprNeg:
+                v = eval(n->left, counter);
+                if (v.isInt()) v = TData::Int(intArith<TMinus>(0, v.asInt()));
+                else if (v.isDouble()) v = TData::Double(-v.asDouble());
+                break;
+            case ExprBinary: {
+                TData l = eval(n->left, counter);
+                TData r = eval(n->right, counter);
+                v = n->fn(l, r);
+                break;
+            }
+            case ExprGroup:
+                v = eval(n->left, counter);
+                break;
+            default:
+                break;
+        }
+        if (n->temp != ExprNode::NoTemp) {
+            temps[n->temp] = v;
+        }
+        return v;
+    }
+};
+
+}  // namespace
+
+// count проходов цикла-редукции. Шаги накопителей и строки вывода
+// считаются в потоках, сами накопители - последовательно в исходном
+// порядке, поэтому переполнение int и округление double те же. Потоки
+// пула workers создаются при первом блоке и служат обеим частям.
+void Parser::runReductionBlock(const LoopInfo& loop, const std::vector<TData*>& places,
+                               const std::vector<int64_t>& deltas, int64_t d,
+                               uint32_t count, unsigned threads) {
+    const size_t n = loop.updates.size();
+    const uint32_t counterSlot = loop.counter->site->frameSlot;
+    auto isCounter = [&](size_t j) {
+        return loop.updates[j].site->frameSlot == counterSlot && !loop.updates[j].site->member;
+    };
+
+    // значение счётчика, которое видит обновление j, от начала прохода
+    std::vector<int64_t> seen(n);
+    int64_t offset = 0;
+    for (size_t j = 0; j < n; ++j) {
+        seen[j] = offset;
+        offset += deltas[j];
+    }
+
+    std::unordered_map<const ExprNode*, TData> fixed;
+    std::vector<const ExprNode*> work;
+    for (size_t j = 0; j < n; ++j) {
+        if (!isCounter(j)) {
+            work.push_back(loop.updates[j].step->root);
+        }
+    }
+    while (!work.empty()) {
+        const ExprNode* e = work.back();
+        work.pop_back();
+        if (e->kind == ExprVar && !(e->site->frameSlot == counterSlot && !e->site->member)) {
+            fixed[e] = *sitePlace(*e->site, resolveSite(*e->site));
+        }
+        if (e->left) work.push_back(e->left);
+        if (e->right) work.push_back(e->right);
+    }
+
+    const TData* counterPlace = sitePlace(*loop.counter->site, resolveSite(*loop.counter->site));
+    const int64_t start = counterPlace->isInt() ? counterPlace->asInt() : 0;
+
+    std::vector<std::vector<TData>> values(n);
+    for (size_t j = 0; j < n; ++j) {
+        if (!isCounter(j)) {
+            values[j].resize(count);
+        }
+    }
+
+    if (!workers) {
+        workers = std::make_unique<ThreadPool>(threads);
+    }
+
+    workers->parallelFor(count, [&](uint32_t begin, uint32_t end) {
+        std::vector<QuietEval> evals;
+        for (size_t j = 0; j < n; ++j) {
+            evals.push_back({counterSlot, fixed, std::vector<TData>(
+                isCounter(j) ? 0 : loop.updates[j].step->tempCount)});
+        }
+        for (uint32_t k = begin; k < end; ++k) {
+            int64_t base = start + k * d;
+            for (size_t j = 0; j < n; ++j) {
+                if (!isCounter(j)) {
+                    values[j][k] = evals[j].eval(loop.updates[j].step->root,
+                                                 static_cast<int>(base + seen[j]));
+                }
+            }
+        }
+    });
+
+    // накопители по ячейкам: два обновления одной ячейки идут подряд
+    std::vector<TData> acc(n);
+    std::vector<size_t> cell(n);
+    for (size_t j = 0; j < n; ++j) {
+        cell[j] = j;
+        for (size_t i = 0; i < j; ++i) {
+            if (places[i] == places[j]) {
+                cell[j] = cell[i];
+                break;
+            }
+        }
+        acc[j] = loadAs(*places[j], loop.updates[j].site->type);
+    }
+    std::vector<BinaryFn> fns(n);
+    for (size_t j = 0; j < n; ++j) {
+        const LoopInfo::Update& u = loop.updates[j];
+        fns[j] = isCounter(j) ? nullptr : binaryFn(u.op, u.site->type, u.stepType);
+    }
+    for (uint32_t k = 0; k < count; ++k) {
+        for (size_t j = 0; j < n; ++j) {
+            if (fns[j]) {
+                TData& a = acc[cell[j]];
+                a = fns[j](a, values[j][k]);
+                values[j][k] = a;
+            }
+        }
+    }
 
-TData Parser::evalBinary(uint16_t op,
-                         const TData& l, PrimitiveDataType lt,
-                         const TData& r, PrimitiveDataType rt,
-                         PrimitiveDataType& resultType) {
-    TData res;
-    res.dataType = TYPE_UNKNOWN;
-    resultType = UndefinedType;
-
-    auto isCompare = [&](uint16_t token) -> bool {
-        return token == TL || token == TG ||
-               token == TLE || token == TGE ||
-               token == TEq || token == TNotEq;
+    auto counterValue = [&](uint32_t k, size_t j) {
+        return TData::Int(static_cast<int>(start + k * d + seen[j] + deltas[j]));
     };
-
-    // В режиме проектирования значения не вычисляем и отладку не печатаем.
-    if (!flagInterpret) {
-        if (isCompare(op)) {
-            resultType = IntType;
-            res.dataType = TYPE_INT;
-            res.dataValue.dataAsInt = 0;
-            return res;
+    if (events) {
+        const uint32_t loopId = static_cast<uint32_t>(&loop - loops.data());
+        for (uint32_t k = 0; k < count; ++k) {
+            events->loop(loopId);
+            for (size_t j = 0; j < n; ++j) {
+                events->assign(loop.updates[j].site->nameId, isCounter(j) ? counterValue(k, j) : values[j][k]);
+            }
         }
+    }
 
-        resultType = (lt == DoubleType || rt == DoubleType) ? DoubleType : IntType;
-        res.dataType = (resultType == DoubleType) ? TYPE_DOUBLE : TYPE_INT;
-        if (res.dataType == TYPE_DOUBLE) res.dataValue.dataAsDouble = 0.0;
-        else res.dataValue.dataAsInt = 0;
-        return res;
-    }
-
-    auto opName = [](uint16_t token) -> const char* {
-        switch (token) {
-            case TPlus:   return "+";
-            case TMinus:  return "-";
-            case TMult:   return "*";
-            case TDiv:    return "/";
-            case TMod:    return "%";
-            case TL:      return "<";
-            case TG:      return ">";
-            case TLE:     return "<=";
-            case TGE:     return ">=";
-            case TEq:     return "==";
-            case TNotEq:  return "!=";
-            default:      return "?";
+    std::vector<std::string> text(events ? 0 : (count + ReductionLines - 1) / ReductionLines);
+    workers->parallelFor(static_cast<uint32_t>(text.size()), [&](uint32_t begin, uint32_t end) {
+        for (uint32_t part = begin; part < end; ++part) {
+            std::string& out = text[part];
+            uint32_t last = std::min(count, (part + 1) * ReductionLines);
+            for (uint32_t k = part * ReductionLines; k < last; ++k) {
+                for (size_t j = 0; j < n; ++j) {
+                    out += loop.updates[j].site->fullName;
+                    out += " = ";
+                    appendValue(out, isCounter(j) ? counterValue(k, j) : values[j][k]);
+                    out += '\n';
+                }
+            }
         }
-    };
-
-    std::cout << "[DEBUG] Операция: ";
-    if (l.dataType == TYPE_INT) std::cout << l.dataValue.dataAsInt << " (int) ";
-    else if (l.dataType == TYPE_DOUBLE) std::cout << l.dataValue.dataAsDouble << " (double) ";
+    });
+    for (const std::string& part : text) {
+        std::cout.write(part.data(), static_cast<std::streamsize>(part.size()));
+    }
 
-    std::cout << opName(op) << " ";
+    for (size_t j = 0; j < n; ++j) {
+        const LoopInfo::Update& u = loop.updates[j];
+        Tree* root = resolveSite(*u.site);
+        Node* decl = (u.site->member ? u.site->member : root)->getNode();
+        TData result = isCounter(j) ? TData::Int(static_cast<int>(start + count * d))
+                                    : acc[cell[j]];
+        touch(u.site);
+        assignValue(decl, *places[j], u.site->type, result);
+    }
+}
 
-    if (r.dataType == TYPE_INT) std::cout << r.dataValue.dataAsInt << " (int) ";
-    else if (r.dataType == TYPE_DOUBLE) std::cout << r.dataValue.dataAsDouble << " (double) ";
+// ++/-- над ячейкой designator'а; результат - новое значение (префикс)
+// или старое (постфикс)
+TData Parser::stepPlace(Node* decl, TData& place, PrimitiveDataType t, uint16_t op, bool postfix) {
+    TData oldVal;
+    TData newVal;
+    if (t == IntType) {
+        int cur = place.isInt() ? place.asInt() : 0;
+        oldVal = makeData<int>(cur);
+        newVal = makeData<int>(cur + ((op == TInc) ? 1 : -1));
+    } else {
+        double cur = place.isDouble()
+                         ? place.asDouble()
+                         : (place.isInt()
+                                ? static_cast<double>(place.asInt())
+                                : 0.0);
+        oldVal = makeData<double>(cur);
+        newVal = makeData<double>(cur + ((op == TInc) ? 1.0 : -1.0));
+    }
+    assignValue(decl, place, t, newVal);
+    return postfix ? oldVal : newVal;
+}
 
-    if (isCompare(op)) {
-        bool cmp = false;
+// Вычисление дерева выражения; трассировка совпадает с разбором
+// Expression/Sum/Mult/Unary/BaseExp.
+TData Parser::evalExpr(const ExprNode* e) {
+    if (e->kind == ExprTemp) {
+        return exprTemps[tempBase + e->temp];
+    }
+    TData v;
+    if (e->hoist != UINT32_MAX) {
+        if (hoistSlots[e->hoist].gen == loopGens[hoistSlots[e->hoist].loop]) {
+            v = hoistSlots[e->hoist].value;
+        } else {
+            v = evalNode(e);
+            HoistSlot& slot = hoistSlots[e->hoist];
+            slot.value = v;
+            slot.gen = loopGens[slot.loop];
+        }
+    } else {
+        v = evalNode(e);
+    }
+    if (e->temp != ExprNode::NoTemp) {
+        exprTemps[tempBase + e->temp] = v;
+    }
+    return v;
+}
 
-        double lv = (l.dataType == TYPE_DOUBLE)
-                        ? l.dataValue.dataAsDouble
-                        : static_cast<double>(l.dataValue.dataAsInt);
-        double rv = (r.dataType == TYPE_DOUBLE)
-                        ? r.dataValue.dataAsDouble
-                        : static_cast<double>(r.dataValue.dataAsInt);
+// Временные ячейки - стеком: выражение может повторно войти в себя через вызов метода.
+TData Parser::evalRoot(const ExprNode* root, uint16_t tempCount) {
+    uint32_t savedTempBase = tempBase;
+    tempBase = static_cast<uint32_t>(exprTemps.size());
+    exprTemps.resize(tempBase + tempCount);
+    TData v = evalExpr(root);
+    exprTemps.resize(tempBase);
+    tempBase = savedTempBase;
+    return v;
+}
 
-        switch (op) {
-            case TL:     cmp = (lv <  rv); break;
-            case TG:     cmp = (lv >  rv); break;
-            case TLE:    cmp = (lv <= rv); break;
-            case TGE:    cmp = (lv >= rv); break;
-            case TEq:    cmp = (lv == rv); break;
-            case TNotEq: cmp = (lv != rv); break;
+// встроенный метод: выражение тела над полями получателя, без перехода в тело
+TData Parser::evalInline(const ExprNode* call, TData* receiver) {
+    if (options.optimize && options.jit && receiver && call->type != UndefinedType) {
+        JitMethod& jit = jitMethods[call->left];
+        if (!jit.tried && ++jit.calls >= options.jit) {
+            jitMethod(call, jit);
+        }
+        if (jit.fn) {
+            uint64_t v = jit.fn(receiver, jitTemps.data());
+            return (call->left->type == DoubleType) ? TData::Double(std::bit_cast<double>(v))
+                                                    : TData::Int(static_cast<int>(v));
         }
+    }
 
-        res.dataType = TYPE_INT;
-        res.dataValue.dataAsInt = cmp ? 1 : 0;
-        resultType = IntType;
+    TData* savedThis = thisBlock;
+    thisBlock = receiver;
+    TData v = evalRoot(call->left, call->op);
+    thisBlock = savedThis;
+    return v;
+}
 
-        std::cout << " -> " << res.dataValue.dataAsInt << " (int, compare)" << std::endl;
-        return res;
+// Поля тела читаются относительно блока получателя, глобальные - по адресу
+// ячейки; локальных в теле { return выражение; } нет.
+void Parser::jitMethod(const ExprNode* call, JitMethod& jit) {
+    jit.tried = true;
+
+    std::vector<const ExprNode*> work{call->left};
+    while (!work.empty()) {
+        const ExprNode* e = work.back();
+        work.pop_back();
+        if (e->kind == ExprVar) {
+            const DesignatorSite& site = *e->site;
+            if (site.frameSlot != Node::NoSlot || !site.root) {
+                return;
+            }
+            JitRead read;
+            const Node* r = site.root->getNode();
+            if (r->objType == ObjField) {
+                read.field = true;
+                read.offset = r->slot + (site.member ? site.memberOffset : 0);
+            } else {
+                read.address = sitePlace(site, site.root);
+                if (!read.address) {
+                    return;
+                }
+            }
+            jit.reads[&site] = read;
+        }
+        if (e->left) work.push_back(e->left);
+        if (e->right) work.push_back(e->right);
     }
 
-    bool useDouble =
-        (l.dataType == TYPE_DOUBLE || r.dataType == TYPE_DOUBLE ||
-         lt == DoubleType || rt == DoubleType);
+    CompiledExpr body;
+    body.root = call->left;
+    body.tempCount = call->op;
+    if (jitCode.compileMethod(body, jit) && jitTemps.size() < call->op) {
+        jitTemps.resize(call->op);
+    }
+}
 
-    if (useDouble) {
-        double lv = (l.dataType == TYPE_DOUBLE) ? l.dataValue.dataAsDouble
-                                                : static_cast<double>(l.dataValue.dataAsInt);
-        double rv = (r.dataType == TYPE_DOUBLE) ? r.dataValue.dataAsDouble
-                                                : static_cast<double>(r.dataValue.dataAsInt);
+TData Parser::evalNode(const ExprNode* e) {
+    switch (e->kind) {
+        case ExprConst:
+            return e->value;
+
+        case ExprVar:
+        case ExprCall:
+        case ExprInline:
+        case ExprPreInc:
+        case ExprPostInc: {
+            const DesignatorSite& site = *e->site;
+            Tree* root = resolveSite(site);
+            if (!root) {
+                throw std::runtime_error("Семантическая ошибка");
+            }
+            TData* place = sitePlace(site, root);
+            Tree* node = site.member ? site.member : root;
 
-        double out = 0.0;
-        switch (op) {
-            case TPlus:  out = lv + rv; break;
-            case TMinus: out = lv - rv; break;
-            case TMult:  out = lv * rv; break;
-            case TDiv:
-                if (rv == 0.0) {
-                    std::cerr << "Warning: division by zero (double)" << std::endl;
+            if (e->kind == ExprVar) {
+                return *place;
+            }
+            if (e->kind == ExprCall || e->kind == ExprInline) {
+                if (e->kind == ExprCall) {
+                    return execMethod(node, site.fullName, place);
                 }
-                out = (rv != 0.0) ? (lv / rv) : 0.0;
-                break;
-            case TMod:
-                std::cerr << "Warning: operator % for double, casting to int" << std::endl;
-                out = static_cast<int>(lv) % static_cast<int>(rv);
-                break;
-            default:
-                std::cerr << "Semantic error: unknown binary operation" << std::endl;
-                break;
+                // встроенное тело имеет свой тип, результат приводится к типу метода
+                TData ret = evalInline(e, place);
+                if (e->type == IntType || e->type == DoubleType) {
+                    ret = convertValue(node->getNode()->id(), e->type, ret);
+                }
+                return ret;
+            }
+            touch(&site);
+            return stepPlace(node->getNode(), *place, e->type, e->op, e->kind == ExprPostInc);
         }
 
-        res.dataType = TYPE_DOUBLE;
-        res.dataValue.dataAsDouble = out;
-        resultType = DoubleType;
+        case ExprNeg: {
+            TData v = evalExpr(e->left);
+            if (v.isInt()) {
+                v = TData::Int(intArith<TMinus>(0, v.asInt()));
+            } else if (v.isDouble()) {
+                v = TData::Double(-v.asDouble());
+            }
+            debugValue<TraceLevel::Ops>("[DEBUG] унарный минус", v, e->type);
+            return v;
+        }
 
-        std::cout << " -> " << out << " (double)" << std::endl;
-        return res;
-    }
+        case ExprBinary: {
+            TData l = evalExpr(e->left);
+            TData r = evalExpr(e->right);
+            TData res = runBinary(e->op, e->fn, l, r);
+            if (e->traceStep) {
+                debugValue<TraceLevel::Ops>("[DEBUG] Шаг", res, e->type);
+            }
+            return res;
+        }
 
-    int lv = l.dataValue.dataAsInt;
-    int rv = r.dataValue.dataAsInt;
-    int out = 0;
+        case ExprGroup: {
+            TData v = evalExpr(e->left);
+            debugValue<TraceLevel::Ops>("[DEBUG] Результат выражения", v, e->type);
+            return v;
+        }
 
-    switch (op) {
-        case TPlus:  out = lv + rv; break;
-        case TMinus: out = lv - rv; break;
-        case TMult:  out = lv * rv; break;
-        case TDiv:
-            if (rv == 0) {
-                std::cerr << "Warning: division by zero (int)" << std::endl;
-            }
-            out = (rv != 0) ? (lv / rv) : 0;
-            break;
-        case TMod:
-            if (rv == 0) {
-                std::cerr << "Warning: modulo by zero" << std::endl;
-                out = 0;
-            } else {
-                out = lv % rv;
-            }
-            break;
-        default:
-            std::cerr << "Semantic error: unknown binary operation" << std::endl;
+        case ExprTemp:
             break;
     }
-
-    res.dataType = TYPE_INT;
-    res.dataValue.dataAsInt = out;
-    resultType = IntType;
-
-    std::cout << " -> " << out << " (int)" << std::endl;
-    return res;
+    return TData();
 }
 
-Parser::Parser(Scanner* scanner)
+Parser::Parser(Scanner* scanner, const ParserOptions& options)
     : scanner(scanner),
+      options(options),
       currentToken(),
       currentTokenCode(0),
       lastType(UndefinedType),
       lastTypeName(),
       exprType(UndefinedType),
       exprValue(),
+      exprNode(nullptr),
       flagInterpret(false),
       flagReturn(false),
       returnType(UndefinedType),
       returnValue(),
       mainTree(nullptr),
       mainBodyPos(0),
-      methodBodyPos() {
+      inlineBodies(),
+      lastReturnExprPos(0),
+      designatorCache(),
+      listEnds(),
+      callFrames(InitialCallDepth),
+      callDepth(0),
+      classLayouts(),
+      objectBlocks(),
+      thisBlock(nullptr),
+      frameSlots(),
+      frameBase(0),
+      currentFunc(nullptr),
+      declSlots(),
+      exprNodes(),
+      exprCache(),
+      exprDepth(0),
+      exprTemps(),
+      tempBase(0),
+      loops(),
+      loopIds(),
+      loopStack(),
+      loopGens(),
+      loopGenCounter(0),
+      hoistSlots(),
+      versionSlots(),
+      fieldVersions(),
+      writeEpoch(0),
+      methodMemos(),
+      analysedMemo(nullptr) {
+    if (!options.eventLog.empty()) {
+        events = std::make_unique<EventLog>(options.eventLog);
+    }
     Node globalNode("global", ObjEmpty, UndefinedType);
     Tree::SetRight(globalNode);
 }
@@ -349,15 +1426,24 @@ bool Parser::compatibleAssign(PrimitiveDataType l, PrimitiveDataType r) {
     return false;
 }
 
+void Parser::analyse() {
+    nextToken();
+    Program();
+    if (currentTokenCode != TEnd) {
+        error("Ожидался конец программы");
+    }
+
+    std::cout << "\nАнализ завершён успешно.\n";
+}
+
+const DesignatorSite* Parser::siteAt(uint32_t pos) const {
+    auto it = designatorCache.find(pos);
+    return it != designatorCache.end() ? &it->second : nullptr;
+}
+
 void Parser::parse() {
     try {
-        nextToken();
-        Program();
-        if (currentTokenCode != TEnd) {
-            error("Ожидался конец программы");
-        }
-
-        std::cout << "\nАнализ завершён успешно.\n";
+        analyse();
 
         if (mainTree) {
             flagInterpret = true;
@@ -368,6 +1454,7 @@ void Parser::parse() {
             debugEvent("Начинаю выполнение main");
 
             Tree::setCurrent(mainTree);
+            uint32_t savedBase = enterFrame(mainTree);
             setUK(mainBodyPos);
 
             Tree::semIn();
@@ -375,6 +1462,7 @@ void Parser::parse() {
             Tree::semOut();
 
             expect(TRFB, "Ожидалась '}'");
+            leaveFrame(savedBase, nullptr);
 
             debugEvent("Завершаю выполнение main");
         }
@@ -394,8 +1482,10 @@ void Parser::Program() {
     expect(TRB,   "Ожидалась ')' после main");
 
     Node mainNode("main", ObjFunc, IntType);
+    mainNode.slot = 0;
     mainTree = Tree::SetRight(mainNode);
     Tree::setCurrent(mainTree);
+    uint32_t savedBase = enterFrame(mainTree);
 
     expect(TLFB, "Ожидалась '{'");
 
@@ -411,6 +1501,7 @@ void Parser::Program() {
     expect(TRFB, "Ожидалась '}'");
 
     flagInterpret = saved;
+    leaveFrame(savedBase, nullptr);
     Tree::setCurrent(mainTree->getParent());
 }
 
@@ -483,6 +1574,9 @@ void Parser::ClassDesc() {
     }
 
     Node cls(className, ObjClass, UndefinedType);
+    cls.slot = static_cast<uint32_t>(classLayouts.size());
+    classLayouts.emplace_back();
+
     Tree* clsNode = Tree::SetRight(cls);
     Tree::setCurrent(clsNode);
 
@@ -493,6 +1587,127 @@ void Parser::ClassDesc() {
     expect(TSemicolon,"Ожидалась ';' после определения класса");
 }
 
+// Смещение поля назначается при объявлении, чтобы методы класса,
+// разбираемые до конца его описания, уже видели раскладку объявленных полей.
+void Parser::layoutField(Tree* classNode, Node* field) {
+    ClassLayout& layout = classLayouts[classNode->getNode()->slot];
+    field->slot = static_cast<uint32_t>(layout.proto.size());
+
+    if (field->datType != UndefinedType) {
+        layout.proto.push_back(field->data);
+        return;
+    }
+
+    Tree* fieldClass = Tree::FindGlobal(field->typeName());
+    if (fieldClass == classNode) {
+        std::cerr << "Семантическая ошибка: класс '" << classNode->getNode()->id()
+                  << "' не может содержать поле своего типа" << std::endl;
+        throw std::runtime_error("Семантическая ошибка");
+    }
+    // поле неизвестного типа места не занимает, обращение к нему - ошибка в parseDesignator
+    if (fieldClass) {
+        const ClassLayout& inner = classLayouts[fieldClass->getNode()->slot];
+        layout.proto.insert(layout.proto.end(), inner.proto.begin(), inner.proto.end());
+    }
+}
+
+uint32_t Parser::allocObject(Tree* classNode) {
+    const ClassLayout& layout = classLayouts[classNode->getNode()->slot];
+
+    std::unique_ptr<TData[]> block(new TData[layout.proto.size()]);
+    std::copy(layout.proto.begin(), layout.proto.end(), block.get());
+
+    objectBlocks.push_back(std::move(block));
+    return static_cast<uint32_t>(objectBlocks.size() - 1);
+}
+
+uint32_t Parser::enterFrame(Tree* func) {
+    uint32_t savedBase = frameBase;
+    frameBase = static_cast<uint32_t>(frameSlots.size());
+    frameSlots.resize(frameBase + func->getNode()->slot, nullptr);
+    currentFunc = func;
+    return savedBase;
+}
+
+void Parser::leaveFrame(uint32_t savedBase, Tree* savedFunc) {
+    frameSlots.resize(frameBase);
+    frameBase = savedBase;
+    currentFunc = savedFunc;
+}
+
+// Ячейка назначается объявлению при анализе (размер кадра функции растёт),
+// при выполнении ячейка кадра указывает на только что созданный узел.
+void Parser::bindLocal(Tree* varNode, uint32_t declPos) {
+    if (!currentFunc) {
+        return;
+    }
+
+    auto it = declSlots.find(declPos);
+    if (it == declSlots.end()) {
+        it = declSlots.emplace(declPos, currentFunc->getNode()->slot++).first;
+    }
+
+    uint32_t slot = it->second;
+    varNode->getNode()->slot = slot;
+
+    // объявление внутри цикла даёт новую переменную на каждом проходе
+    for (uint32_t loopId : loopStack) {
+        loops[loopId].writes.insert({(uint64_t(1) << 63) | slot, LoopInfo::WholeRoot});
+    }
+    if (frameBase + slot >= frameSlots.size()) {
+        frameSlots.resize(frameBase + slot + 1, nullptr);
+    }
+    frameSlots[frameBase + slot] = varNode;
+}
+
+void Parser::noteWrite(const DesignatorSite* site) {
+    for (uint32_t loopId : loopStack) {
+        loops[loopId].writes.insert({cellRoot(*site), cellOffset(*site)});
+    }
+    if (site->version != Node::NoSlot) {
+        markImpure();
+    }
+}
+
+// метод может изменить любые поля и глобальные, а также весь объект-получатель
+void Parser::noteCall(const DesignatorSite* site) {
+    for (uint32_t loopId : loopStack) {
+        loops[loopId].hasCall = true;
+        loops[loopId].writes.insert({cellRoot(*site), LoopInfo::WholeRoot});
+    }
+
+    if (!analysedMemo) {
+        return;
+    }
+    auto callee = methodMemos.find(site->member ? site->member : site->root);
+    if (callee == methodMemos.end()) {
+        analysedMemo->pure = false;
+        return;
+    }
+    analysedMemo->reads.insert(analysedMemo->reads.end(),
+                               callee->second.reads.begin(), callee->second.reads.end());
+}
+
+void Parser::noteRead(const DesignatorSite* site) {
+    if (analysedMemo && site->version != Node::NoSlot) {
+        analysedMemo->reads.push_back(site->version);
+    }
+}
+
+void Parser::markImpure() {
+    if (analysedMemo) {
+        analysedMemo->pure = false;
+    }
+}
+
+// запись поля или глобальной делает недействительными запомненные результаты,
+// которые их читали
+void Parser::touch(const DesignatorSite* site) {
+    if (site->version != Node::NoSlot) {
+        fieldVersions[site->version] = ++writeEpoch;
+    }
+}
+
 void Parser::ClassBody() {
     while (currentTokenCode == TInt ||
            currentTokenCode == TDouble ||
@@ -537,27 +1752,65 @@ void Parser::Method() {
     expect(TRB, "Ожидалась ')' - методы без параметров");
 
     Node m(methodName, ObjMethod, lastType);
+    m.slot = 0;
     Tree* mNode = Tree::SetRight(m);
     Tree::setCurrent(mNode);
+    uint32_t savedBase = enterFrame(mNode);
 
     expect(TLFB, "Ожидалась '{'");
 
-    // старт тела метода
-    methodBodyPos[mNode] = scanner->getTokenStartPos();
+    // старт тела метода хранится в data узла метода
+    mNode->getNode()->data = TData::Int(static_cast<int>(scanner->getTokenStartPos()));
+    bool startsWithReturn = (currentTokenCode == TReturn);
 
     bool saved = flagInterpret;
     flagInterpret = false;
 
+    MethodMemo memo;
+    analysedMemo = options.optimize ? &memo : nullptr;
+
     Tree::semIn();
     OperatorsList();
     Tree::semOut();
 
+    if (analysedMemo && memo.pure) {
+        std::sort(memo.reads.begin(), memo.reads.end());
+        memo.reads.erase(std::unique(memo.reads.begin(), memo.reads.end()), memo.reads.end());
+        methodMemos.emplace(mNode, std::move(memo));
+    }
+    analysedMemo = nullptr;
+
+    if (startsWithReturn && options.optimize && options.inlineLimit > 0) {
+        recordInlineBody(mNode);
+    }
+
     expect(TRFB, "Ожидалась '}'");
 
     flagInterpret = saved;
+    leaveFrame(savedBase, nullptr);
     Tree::setCurrent(mNode->getParent());
 }
 
+// Тело из единственного оператора return встраивается в места вызова:
+// выражение уже построено, за ним должны сразу идти ';' и '}'.
+void Parser::recordInlineBody(Tree* methodNode) {
+    auto body = exprCache.find(lastReturnExprPos);
+    if (body == exprCache.end()) {
+        return;
+    }
+
+    uint32_t closePos = scanner->getTokenStartPos();
+    setUK(body->second.endPos);
+    bool single = (currentTokenCode == TSemicolon);
+    nextToken();
+    single = single && scanner->getTokenStartPos() == closePos;
+    setUK(closePos);
+
+    if (single && inlineCost(body->second.root) <= options.inlineLimit) {
+        inlineBodies.emplace(methodNode, body->second);
+    }
+}
+
 void Parser::Field() {
     Type();
     std::string fieldName = expectId("Ожидался идентификатор поля");
@@ -567,13 +1820,15 @@ void Parser::Field() {
             throw std::runtime_error("Семантическая ошибка: дублирование поля");
         }
 
+        Tree* fieldNode = nullptr;
         if (lastType == UndefinedType && !lastTypeName.empty()) {
             Node f(fieldName, ObjField, UndefinedType, false, lastTypeName);
-            Tree::SetRight(f);
+            fieldNode = Tree::SetRight(f);
         } else {
             Node f(fieldName, ObjField, lastType);
-            Tree::SetRight(f);
+            fieldNode = Tree::SetRight(f);
         }
+        layoutField(Tree::getCurrent(), fieldNode->getNode());
 
         if (currentTokenCode == TComma) {
             nextToken();
@@ -621,7 +1876,7 @@ void Parser::ConstValueDesc() {
     Tree* constNode = Tree::SetRight(c);
 
     if (flagInterpret && constNode && constNode->getNode()) {
-        assignValue(constNode->getNode(), lastType, exprValue);
+        assignValue(constNode->getNode(), constNode->getNode()->data, lastType, exprValue);
     }
 }
 
@@ -631,15 +1886,13 @@ void Parser::Const() {
     if (currentTokenCode == TConstInt) {
         exprType = IntType;
         if (flagInterpret) {
-            exprValue.dataType = TYPE_INT;
-            exprValue.dataValue.dataAsInt = std::stoi(currentToken);
+            exprValue = TData::Int(std::stoi(currentToken));
         }
         nextToken();
     } else if (currentTokenCode == TConstDouble) {
         exprType = DoubleType;
         if (flagInterpret) {
-            exprValue.dataType = TYPE_DOUBLE;
-            exprValue.dataValue.dataAsDouble = std::stod(currentToken);
+            exprValue = TData::Double(std::stod(currentToken));
         }
         nextToken();
     } else {
@@ -656,12 +1909,21 @@ void Parser::CompositeOperator() {
 }
 
 void Parser::OperatorsList() {
+    const uint32_t startPos = scanner->getTokenStartPos();
     while (currentTokenCode != TRFB && currentTokenCode != TEnd) {
         if (flagReturn) {
+            // операторы после return не разбираются
+            auto end = listEnds.find(startPos);
+            if (end != listEnds.end()) {
+                setUK(end->second);
+            }
             return;
         }
         Operator();
     }
+    if (!flagInterpret) {
+        listEnds.emplace(startPos, scanner->getTokenStartPos());
+    }
 }
 
 void Parser::Operator() {
@@ -699,42 +1961,31 @@ void Parser::Statement() {
             error("Ожидался идентификатор после '++/--'");
         }
 
-        bool isMethodCall = false;
-        std::string name;
-        Tree* targetNode = parseDesignator(false, isMethodCall, name);
+        const DesignatorSite* site = nullptr;
+        TData* place = nullptr;
+        Tree* targetNode = parseDesignator(false, site, place);
 
         if (!targetNode || !targetNode->getNode()) {
             throw std::runtime_error("Семантическая ошибка");
         }
-        if (!checkLValue(targetNode)) {
+        if (!site->isLValue) {
             std::cerr << "Семантическая ошибка: '++/--' применимы только к переменным/полям" << std::endl;
             throw std::runtime_error("Семантическая ошибка");
         }
+        noteWrite(site);
+        markImpure();
+        noteUpdate(site, op, UINT32_MAX);
 
-        PrimitiveDataType t = targetNode->getNode()->datType;
+        PrimitiveDataType t = site->type;
         if (!(t == IntType || t == DoubleType)) {
             std::cerr << "Семантическая ошибка: '++/--' применимы только к числовым типам" << std::endl;
             throw std::runtime_error("Семантическая ошибка");
         }
 
         if (flagInterpret) {
-            if (t == IntType) {
-                int cur = (targetNode->getNode()->data.dataType == TYPE_INT) ? targetNode->getNode()->data.dataValue.dataAsInt : 0;
-                cur += (op == TInc) ? 1 : -1;
-                TData tmp; tmp.dataType = TYPE_INT; tmp.dataValue.dataAsInt = cur;
-                assignValue(targetNode->getNode(), IntType, tmp);
-                printAssignment(targetNode->getNode(), name);
-            } else {
-                double cur = (targetNode->getNode()->data.dataType == TYPE_DOUBLE)
-                                 ? targetNode->getNode()->data.dataValue.dataAsDouble
-                                 : (targetNode->getNode()->data.dataType == TYPE_INT
-                                        ? static_cast<double>(targetNode->getNode()->data.dataValue.dataAsInt)
-                                        : 0.0);
-                cur += (op == TInc) ? 1.0 : -1.0;
-                TData tmp; tmp.dataType = TYPE_DOUBLE; tmp.dataValue.dataAsDouble = cur;
-                assignValue(targetNode->getNode(), DoubleType, tmp);
-                printAssignment(targetNode->getNode(), name);
-            }
+            touch(site);
+            (void)stepPlace(targetNode->getNode(), *place, t, op, false);
+            printAssignment(site->nameId, *place);
         }
 
         expect(TSemicolon, "Ожидалась ';' после '++/--'");
@@ -745,7 +1996,9 @@ void Parser::Statement() {
     if (currentTokenCode == TInt || currentTokenCode == TDouble) {
         PrimitiveDataType declType = (currentTokenCode == TInt ? IntType : DoubleType);
         nextToken();
+        noteComplexStatement();
 
+        uint32_t declPos = scanner->getTokenStartPos();
         std::string varName = expectId("Ожидался идентификатор переменной");
         if (!checkDuplicateId(varName)) {
             throw std::runtime_error("Семантическая ошибка: дублирование переменной");
@@ -761,14 +2014,16 @@ void Parser::Statement() {
                 throw std::runtime_error("Семантическая ошибка");
             }
             hasInit = true;
+            markImpure();
         }
 
         Node v(varName, ObjVar, declType, hasInit, "");
         Tree* varNode = Tree::SetRight(v);
+        bindLocal(varNode, declPos);
 
         if (flagInterpret && hasInit && varNode && varNode->getNode()) {
-            assignValue(varNode->getNode(), declType, exprValue);
-            printAssignment(varNode->getNode(), varName);
+            assignValue(varNode->getNode(), varNode->getNode()->data, declType, exprValue);
+            printAssignment(varNode->getNode()->nameId, varNode->getNode()->data);
         }
 
         expect(TSemicolon, "Ожидалась ';' после объявления");
@@ -786,6 +2041,7 @@ void Parser::Statement() {
         if (currentTokenCode == TId) {
             std::string typeName = savedToken;
             std::string varName  = currentToken;
+            uint32_t declPos = scanner->getTokenStartPos();
             nextToken();
 
             if (!checkDuplicateId(varName)) {
@@ -803,8 +2059,10 @@ void Parser::Statement() {
                 throw std::runtime_error("Семантическая ошибка");
             }
 
+            noteComplexStatement();
             Node v(varName, ObjVar, UndefinedType, false, typeName);
-            Tree::SetRight(v);
+            v.data = TData::Unknown(static_cast<int>(allocObject(classDef)));
+            bindLocal(Tree::SetRight(v), declPos);
 
             expect(TSemicolon, "Ожидалась ';' после объявления");
             return;
@@ -815,17 +2073,19 @@ void Parser::Statement() {
         currentToken = savedToken;
         currentTokenCode = savedCode;
 
-        bool isMethodCall = false;
-        std::string designatorName;
-        Tree* targetNode = parseDesignator(true, isMethodCall, designatorName);
+        const DesignatorSite* site = nullptr;
+        TData* place = nullptr;
+        Tree* targetNode = parseDesignator(true, site, place);
 
         if (!targetNode || !targetNode->getNode()) {
             throw std::runtime_error("Семантическая ошибка");
         }
 
-        if (isMethodCall) {
+        if (site->isMethodCall) {
+            noteCall(site);
+            noteComplexStatement();
             if (flagInterpret) {
-                (void)execMethod(targetNode, designatorName);
+                (void)execMethod(targetNode, site->fullName, place);
             }
             expect(TSemicolon, "Ожидалась ';' после вызова метода");
             return;
@@ -833,12 +2093,14 @@ void Parser::Statement() {
 
         // postfix ++/-- как оператор
         if (currentTokenCode == TInc || currentTokenCode == TDec) {
-            if (!checkLValue(targetNode)) {
+            if (!site->isLValue) {
                 std::cerr << "Семантическая ошибка: '++/--' применимы только к переменным/полям" << std::endl;
                 throw std::runtime_error("Семантическая ошибка");
             }
+            noteWrite(site);
+            markImpure();
 
-            PrimitiveDataType t = targetNode->getNode()->datType;
+            PrimitiveDataType t = site->type;
             if (!(t == IntType || t == DoubleType)) {
                 std::cerr << "Семантическая ошибка: '++/--' применимы только к числовым типам" << std::endl;
                 throw std::runtime_error("Семантическая ошибка");
@@ -846,25 +2108,12 @@ void Parser::Statement() {
 
             uint16_t op = currentTokenCode;
             nextToken();
+            noteUpdate(site, op, UINT32_MAX);
 
             if (flagInterpret) {
-                if (t == IntType) {
-                    int cur = (targetNode->getNode()->data.dataType == TYPE_INT) ? targetNode->getNode()->data.dataValue.dataAsInt : 0;
-                    cur += (op == TInc) ? 1 : -1;
-                    TData tmp; tmp.dataType = TYPE_INT; tmp.dataValue.dataAsInt = cur;
-                    assignValue(targetNode->getNode(), IntType, tmp);
-                    printAssignment(targetNode->getNode(), designatorName);
-                } else {
-                    double cur = (targetNode->getNode()->data.dataType == TYPE_DOUBLE)
-                                     ? targetNode->getNode()->data.dataValue.dataAsDouble
-                                     : (targetNode->getNode()->data.dataType == TYPE_INT
-                                            ? static_cast<double>(targetNode->getNode()->data.dataValue.dataAsInt)
-                                            : 0.0);
-                    cur += (op == TInc) ? 1.0 : -1.0;
-                    TData tmp; tmp.dataType = TYPE_DOUBLE; tmp.dataValue.dataAsDouble = cur;
-                    assignValue(targetNode->getNode(), DoubleType, tmp);
-                    printAssignment(targetNode->getNode(), designatorName);
-                }
+                touch(site);
+                (void)stepPlace(targetNode->getNode(), *place, t, op, false);
+                printAssignment(site->nameId, *place);
             }
 
             expect(TSemicolon, "Ожидалась ';' после '++/--'");
@@ -875,12 +2124,14 @@ void Parser::Statement() {
             currentTokenCode == TPlusEq || currentTokenCode == TMinusEq ||
             currentTokenCode == TMultEq || currentTokenCode == TDivEq  || currentTokenCode == TModEq) {
 
-            if (!checkLValue(targetNode)) {
+            if (!site->isLValue) {
                 std::cerr << "Семантическая ошибка: слева от присваивания должно быть изменяемое значение" << std::endl;
                 throw std::runtime_error("Семантическая ошибка");
             }
+            noteWrite(site);
+            markImpure();
 
-            PrimitiveDataType leftType = targetNode->getNode()->datType;
+            PrimitiveDataType leftType = site->type;
             if (!(leftType == IntType || leftType == DoubleType)) {
                 std::cerr << "Семантическая ошибка: присваивание возможно только для числовых типов" << std::endl;
                 throw std::runtime_error("Семантическая ошибка");
@@ -888,8 +2139,15 @@ void Parser::Statement() {
 
             uint16_t assignOp = currentTokenCode;
             nextToken();
+            uint32_t rhsPos = scanner->getTokenStartPos();
             Expression();
 
+            if (assignOp == TPlusEq || assignOp == TMinusEq) {
+                noteUpdate(site, (assignOp == TPlusEq) ? TPlus : TMinus, rhsPos);
+            } else {
+                noteComplexStatement();
+            }
+
             if (!(exprType == IntType || exprType == DoubleType)) {
                 std::cerr << "Семантическая ошибка: справа должно быть числовое выражение" << std::endl;
                 throw std::runtime_error("Семантическая ошибка");
@@ -902,8 +2160,9 @@ void Parser::Statement() {
                 }
 
                 if (flagInterpret) {
-                    assignValue(targetNode->getNode(), leftType, exprValue);
-                    printAssignment(targetNode->getNode(), designatorName);
+                    touch(site);
+                    assignValue(targetNode->getNode(), *place, leftType, exprValue);
+                    printAssignment(site->nameId, *place);
                 }
 
                 expect(TSemicolon, "Ожидалась ';' после присваивания");
@@ -923,16 +2182,10 @@ void Parser::Statement() {
             PrimitiveDataType resType;
             TData leftVal;
 
-            if (leftType == DoubleType) {
-                leftVal.dataType = TYPE_DOUBLE;
-                if (targetNode->getNode()->data.dataType == TYPE_DOUBLE) leftVal.dataValue.dataAsDouble = targetNode->getNode()->data.dataValue.dataAsDouble;
-                else if (targetNode->getNode()->data.dataType == TYPE_INT) leftVal.dataValue.dataAsDouble = static_cast<double>(targetNode->getNode()->data.dataValue.dataAsInt);
-                else leftVal.dataValue.dataAsDouble = 0.0;
+            if (!flagInterpret) {
+                leftVal = (leftType == DoubleType) ? makeData<double>(0.0) : makeData<int>(0);
             } else {
-                leftVal.dataType = TYPE_INT;
-                if (targetNode->getNode()->data.dataType == TYPE_INT) leftVal.dataValue.dataAsInt = targetNode->getNode()->data.dataValue.dataAsInt;
-                else if (targetNode->getNode()->data.dataType == TYPE_DOUBLE) leftVal.dataValue.dataAsInt = static_cast<int>(targetNode->getNode()->data.dataValue.dataAsDouble);
-                else leftVal.dataValue.dataAsInt = 0;
+                leftVal = loadAs(*place, leftType);
             }
 
             TData res = evalBinary(opToken, leftVal, leftType, exprValue, exprType, resType);
@@ -943,8 +2196,9 @@ void Parser::Statement() {
             }
 
             if (flagInterpret) {
-                assignValue(targetNode->getNode(), leftType, res);
-                printAssignment(targetNode->getNode(), designatorName);
+                touch(site);
+                assignValue(targetNode->getNode(), *place, leftType, res);
+                printAssignment(site->nameId, *place);
             }
 
             expect(TSemicolon, "Ожидалась ';' после присваивания");
@@ -967,43 +2221,86 @@ void Parser::While() {
 
     const bool outerInterpret = flagInterpret;
 
+    // первый разбор цикла - анализ: собираем его выражения и записи
+    uint32_t loopId = 0;
+    auto known = loopIds.find(ukCond);
+    const bool analysing = (known == loopIds.end());
+    if (analysing) {
+        noteComplexStatement();
+        loopId = static_cast<uint32_t>(loops.size());
+        loops.emplace_back();
+        loopGens.push_back(0);
+        loopIds.emplace(ukCond, loopId);
+        loopStack.push_back(loopId);
+    } else {
+        loopId = known->second;
+    }
+
+    // новый проход цикла: вынесенные значения прошлого прохода недействительны
+    uint64_t savedGen = loopGens[loopId];
+    loopGens[loopId] = ++loopGenCounter;
+
     debugEvent("Начинаю while");
     debugFlag("while(entry)");
 
     while (true) {
+        // while (0): тело пропускается без разбора
+        if (outerInterpret && loops[loopId].never) {
+            setUK(loops[loopId].endPos);
+            break;
+        }
+        if (outerInterpret && loops[loopId].direct) {
+            runDirectLoop(loopId);
+            break;
+        }
+
         setUK(ukCond);
         debugEvent("while: перемотка на условие");
         debugFlag("while(rewind)");
 
         expect(TLB, "Ожидалась '(' после while");
-        Expression();
+        uint32_t condPos = scanner->getTokenStartPos();
 
-        if (!(exprType == IntType || exprType == DoubleType)) {
-            std::cerr
-                << "Семантическая ошибка: условие while должно быть числовым"
-                << std::endl;
-            throw std::runtime_error("Семантическая ошибка");
-        }
+        bool cond = false;
+        if (outerInterpret && loops[loopId].test) {
+            cond = loopCondition(loops[loopId]);
+            setUK(loops[loopId].cond->endPos);
+        } else {
+            Expression();
 
-        expect(TRB, "Ожидалась ')' после условия");
+            if (!(exprType == IntType || exprType == DoubleType)) {
+                std::cerr
+                    << "Семантическая ошибка: условие while должно быть числовым"
+                    << std::endl;
+                throw std::runtime_error("Семантическая ошибка");
+            }
 
-        bool cond = false;
-        if (outerInterpret) {
-            cond = condToBool(exprValue);
+            if (outerInterpret) {
+                cond = condToBool(exprValue);
+            }
         }
 
-        debugEvent(std::string("while: условие=") + (cond ? "true" : "false"));
+        expect(TRB, "Ожидалась ')' после условия");
+
+        debugEvent("while: условие=", cond ? "true" : "false");
 
         flagInterpret = (outerInterpret && cond);
+        if (events && flagInterpret) {
+            events->loop(loopId);
+        }
         debugEvent("while: устанавливаю flagInterpret = outer && cond");
         debugFlag("while(body-flag)");
 
         Operator();
 
+        if (analysing && !loops[loopId].bodySeen) {
+            classifyLoop(loopId, condPos);
+        }
+
         if (flagReturn) {
             debugEvent("while: выход по return (flagReturn=TRUE)");
             debugFlag("while(return)");
-            return;
+            break;
         }
 
         flagInterpret = outerInterpret;
@@ -1013,71 +2310,116 @@ void Parser::While() {
         if (!outerInterpret) {
             debugEvent("while: внешний контекст DOWN -> выхожу из while");
             debugFlag("while(exit-outer-down)");
-            return;
+            break;
         }
 
         if (!cond) {
             debugEvent("while: условие ложно -> выхожу из while");
             debugFlag("while(exit-cond-false)");
-            return;
+            break;
         }
 
         debugEvent("while: следующая итерация");
     }
-}
 
+    loopGens[loopId] = savedGen;
+
+    if (analysing) {
+        loopStack.pop_back();
+        if (options.optimize) {
+            hoistInvariants(loopId);
+        }
+    }
+}
 
-TData Parser::execMethod(Tree* methodNode, const std::string& fullName) {
-    // (оставлено как в твоём файле; эта часть не влияет на ошибку while)
-    TData res;
-    res.dataType = TYPE_UNKNOWN;
 
-    auto it = methodBodyPos.find(methodNode);
-    if (it == methodBodyPos.end()) {
-        throw std::runtime_error("Semantic error: method start not found");
+// Результат приводится к типу метода, как при присваивании (с сообщением
+// и при повторе из memo); метод без return возвращает 0.
+static TData methodResult(const Node* method, const TData& value) {
+    if (method->datType == IntType || method->datType == DoubleType) {
+        return convertValue(method->id(), method->datType, value);
     }
+    return value;
+}
 
-    uint32_t savedPos = getUK();
-    std::string savedTok = currentToken;
-    uint16_t savedCode = currentTokenCode;
-    Tree* savedCur = Tree::getCurrent();
+TData Parser::execMethod(Tree* methodNode, const std::string& fullName, TData* receiver) {
+    Node* method = methodNode->getNode();
+
+    // метод только для чтения: результат действителен, пока не записаны прочитанные им поля
+    MethodMemo* memo = nullptr;
+    if (!methodMemos.empty() && receiver) {
+        auto memoIt = methodMemos.find(methodNode);
+        if (memoIt != methodMemos.end()) {
+            memo = &memoIt->second;
+            auto hit = memo->cache.find(receiver);
+            if (hit != memo->cache.end()) {
+                bool valid = std::all_of(memo->reads.begin(), memo->reads.end(), [&](uint32_t v) {
+                    return fieldVersions[v] <= hit->second.epoch;
+                });
+                if (valid) {
+                    return methodResult(method, hit->second.value);
+                }
+            }
+        }
+    }
 
-    bool savedInterpret = flagInterpret;
-    bool savedReturn = flagReturn;
-    PrimitiveDataType savedRetType = returnType;
-    TData savedRetVal = returnValue;
+    if (callDepth == callFrames.size()) {
+        callFrames.resize(callFrames.size() * 2);
+    }
+    CallFrame& frame = callFrames[callDepth++];
+    frame.scope = Tree::getCurrent();
+    frame.func = currentFunc;
+    frame.receiver = thisBlock;
+    frame.returnValue = returnValue;
+    frame.resumePos = scanner->getTokenStartPos();
+    frame.returnType = returnType;
+    frame.interpret = flagInterpret;
+    frame.returning = flagReturn;
 
     flagInterpret = true;
+    if (events) {
+        events->enter(method->nameId);
+    }
 
-    debugEvent(std::string("Перехожу к методу: ") + fullName);
+    debugEvent("Перехожу к методу: ", fullName);
     debugFlag("method(enter)");
 
     flagReturn = false;
-    returnType = methodNode->getNode()->datType;
+    returnType = method->datType;
     returnValue = TData();
 
     Tree::setCurrent(methodNode);
-    setUK(it->second);
+    thisBlock = receiver;
+    frame.frameBase = enterFrame(methodNode);
+    setUK(static_cast<uint32_t>(method->data.asInt()));
 
     Tree::semIn();
     OperatorsList();
     Tree::semOut();
     expect(TRFB, "Ожидалась '}'");
 
-    res = returnValue;
+    if (memo) {
+        memo->cache[receiver] = MethodMemo::Entry{returnValue, writeEpoch};
+    }
+    const TData res = methodResult(method, returnValue);
 
-    debugEvent(std::string("Возвращаю значение из метода: ") + fullName);
-    debugValue("[DEBUG] return value", res, returnType);
+    if (events) {
+        events->exit(method->nameId, res);
+    }
+    debugEvent("Возвращаю значение из метода: ", fullName);
+    debugValue<TraceLevel::Events>("[DEBUG] return value", res, returnType);
 
-    flagInterpret = savedInterpret;
-    flagReturn = savedReturn;
-    returnType = savedRetType;
-    returnValue = savedRetVal;
+    // рекурсивный вызов мог перевыделить callFrames
+    const CallFrame& saved = callFrames[--callDepth];
+    flagInterpret = saved.interpret;
+    flagReturn = saved.returning;
+    returnType = saved.returnType;
+    returnValue = saved.returnValue;
 
-    Tree::setCurrent(savedCur);
-    scanner->setPos(savedPos);
-    currentToken = savedTok;
-    currentTokenCode = savedCode;
+    leaveFrame(saved.frameBase, saved.func);
+    Tree::setCurrent(saved.scope);
+    thisBlock = saved.receiver;
+    setUK(saved.resumePos);
 
     debugFlag("method(exit)");
     return res;
@@ -1088,6 +2430,8 @@ void Parser::Return() {
     debugFlag("return(seen)");
 
     expect(TReturn, "Ожидалось 'return'");
+    noteComplexStatement();
+    lastReturnExprPos = scanner->getTokenStartPos();
     Expression();
 
     if (!(exprType == IntType || exprType == DoubleType)) {
@@ -1101,6 +2445,9 @@ void Parser::Return() {
 
     if (flagInterpret) {
         returnValue = exprValue;
+        if (events) {
+            events->ret(exprValue);
+        }
 
         flagReturn = true;
         debugEvent("return: поднимаю flagReturn=TRUE");
@@ -1116,11 +2463,31 @@ void Parser::Return() {
 }
 
 void Parser::Expression() {
+    uint32_t startPos = scanner->getTokenStartPos();
+
+    // повторный разбор: дерево выражения уже построено при анализе,
+    // вычисляем его и перематываем за выражение
+    auto cached = exprCache.find(startPos);
+    if (cached != exprCache.end()) {
+        const CompiledExpr& compiled = cached->second;
+        resetExpr();
+        if (flagInterpret) {
+            exprValue = evalRoot(compiled.root, compiled.tempCount);
+        }
+        // вызов метода при вычислении разбирает выражения тела и меняет exprType/exprNode
+        exprType = compiled.root->type;
+        exprNode = compiled.root;
+        setUK(compiled.endPos);
+        return;
+    }
+
     resetExpr();
+    exprDepth++;
 
     Sum();
     TData leftVal = exprValue;
     PrimitiveDataType leftType = exprType;
+    ExprNode* leftNode = exprNode;
 
     if (currentTokenCode == TL || currentTokenCode == TG ||
         currentTokenCode == TLE || currentTokenCode == TGE ||
@@ -1137,15 +2504,29 @@ void Parser::Expression() {
         TData res = evalBinary(op, leftVal, leftType, rightVal, rightType, resType);
         exprValue = res;
         exprType = resType;
+        leftNode = binaryNode(op, leftNode, exprNode, resType, false);
     }
 
-    debugValue("[DEBUG] Результат выражения", exprValue, exprType);
+    exprNode = newExprNode(ExprGroup, exprType);
+    exprNode->left = leftNode;
+
+    // запоминается только внешнее выражение: вложенные выполняются в его составе
+    if (--exprDepth == 0) {
+        uint16_t temps = options.optimize ? numberValues(exprNode) : 0;
+        exprCache.emplace(startPos, CompiledExpr{exprNode, scanner->getTokenStartPos(), temps});
+        for (uint32_t loopId : loopStack) {
+            loops[loopId].exprs.push_back(exprNode);
+        }
+    }
+
+    debugValue<TraceLevel::Ops>("[DEBUG] Результат выражения", exprValue, exprType);
 }
 
 void Parser::Sum() {
     Mult();
     TData accVal = exprValue;
     PrimitiveDataType accType = exprType;
+    ExprNode* accNode = exprNode;
 
     while (currentTokenCode == TPlus || currentTokenCode == TMinus) {
         uint16_t op = currentTokenCode;
@@ -1159,18 +2540,21 @@ void Parser::Sum() {
         TData res = evalBinary(op, accVal, accType, rightVal, rightType, resType);
         accVal = res;
         accType = resType;
+        accNode = binaryNode(op, accNode, exprNode, resType, true);
 
-        debugValue("[DEBUG] Шаг", accVal, accType);
+        debugValue<TraceLevel::Ops>("[DEBUG] Шаг", accVal, accType);
     }
 
     exprValue = accVal;
     exprType = accType;
+    exprNode = accNode;
 }
 
 void Parser::Mult() {
     Unary();
     TData accVal = exprValue;
     PrimitiveDataType accType = exprType;
+    ExprNode* accNode = exprNode;
 
     while (currentTokenCode == TMult ||
            currentTokenCode == TDiv ||
@@ -1187,12 +2571,14 @@ void Parser::Mult() {
         TData res = evalBinary(op, accVal, accType, rightVal, rightType, resType);
         accVal = res;
         accType = resType;
+        accNode = binaryNode(op, accNode, exprNode, resType, true);
 
-        debugValue("[DEBUG] Шаг", accVal, accType);
+        debugValue<TraceLevel::Ops>("[DEBUG] Шаг", accVal, accType);
     }
 
     exprValue = accVal;
     exprType = accType;
+    exprNode = accNode;
 }
 
 void Parser::Unary() {
@@ -1205,47 +2591,36 @@ void Parser::Unary() {
             error("Ожидался идентификатор после '++/--'");
         }
 
-        bool isMethodCall = false;
-        std::string fullName;
-        Tree* node = parseDesignator(false, isMethodCall, fullName);
+        const DesignatorSite* site = nullptr;
+        TData* place = nullptr;
+        Tree* node = parseDesignator(false, site, place);
 
         if (!node || !node->getNode()) {
             throw std::runtime_error("Семантическая ошибка");
         }
 
-        if (!checkLValue(node)) {
+        if (!site->isLValue) {
             std::cerr << "Семантическая ошибка: '++/--' применимы только к переменным/полям" << std::endl;
             throw std::runtime_error("Семантическая ошибка");
         }
+        noteWrite(site);
 
-        exprType = node->getNode()->datType;
+        exprType = site->type;
         if (!(exprType == IntType || exprType == DoubleType)) {
             std::cerr << "Семантическая ошибка: '++/--' применимы только к числовым типам" << std::endl;
             throw std::runtime_error("Семантическая ошибка");
         }
 
         if (flagInterpret) {
-            if (exprType == IntType) {
-                int cur = (node->getNode()->data.dataType == TYPE_INT) ? node->getNode()->data.dataValue.dataAsInt : 0;
-                cur += (op == TInc) ? 1 : -1;
-                TData tmp; tmp.dataType = TYPE_INT; tmp.dataValue.dataAsInt = cur;
-                assignValue(node->getNode(), IntType, tmp);
-                exprValue = tmp;
-            } else {
-                double cur = (node->getNode()->data.dataType == TYPE_DOUBLE)
-                                 ? node->getNode()->data.dataValue.dataAsDouble
-                                 : (node->getNode()->data.dataType == TYPE_INT
-                                        ? static_cast<double>(node->getNode()->data.dataValue.dataAsInt)
-                                        : 0.0);
-                cur += (op == TInc) ? 1.0 : -1.0;
-                TData tmp; tmp.dataType = TYPE_DOUBLE; tmp.dataValue.dataAsDouble = cur;
-                assignValue(node->getNode(), DoubleType, tmp);
-                exprValue = tmp;
-            }
+            touch(site);
+            exprValue = stepPlace(node->getNode(), *place, exprType, op, false);
         } else {
-            exprValue.dataType = TYPE_UNKNOWN;
+            exprValue.retag(TYPE_UNKNOWN);
         }
 
+        exprNode = newExprNode(ExprPreInc, exprType);
+        exprNode->op = op;
+        exprNode->site = site;
         return;
     }
 
@@ -1260,35 +2635,107 @@ void Parser::Unary() {
 
     BaseExp();
 
-    if (negate && flagInterpret) {
-        if (exprValue.dataType == TYPE_INT) {
-            exprValue.dataValue.dataAsInt = -exprValue.dataValue.dataAsInt;
-        } else if (exprValue.dataType == TYPE_DOUBLE) {
-            exprValue.dataValue.dataAsDouble = -exprValue.dataValue.dataAsDouble;
+    if (!negate) {
+        return;
+    }
+
+    const TData* v = options.optimize ? foldedValue(exprNode) : nullptr;
+    if (v) {
+        ExprNode* folded = newExprNode(ExprConst, exprType);
+        folded->value = *v;
+        if (v->isInt()) {
+            folded->value = TData::Int(intArith<TMinus>(0, v->asInt()));
+        } else if (v->isDouble()) {
+            folded->value = TData::Double(-v->asDouble());
+        }
+        exprNode = folded;
+    } else {
+        ExprNode* neg = newExprNode(ExprNeg, exprType);
+        neg->left = exprNode;
+        exprNode = neg;
+    }
+
+    if (flagInterpret) {
+        if (exprValue.isInt()) {
+            exprValue = TData::Int(intArith<TMinus>(0, exprValue.asInt()));
+        } else if (exprValue.isDouble()) {
+            exprValue = TData::Double(-exprValue.asDouble());
         }
-        debugValue("[DEBUG] унарный минус", exprValue, exprType);
+        debugValue<TraceLevel::Ops>("[DEBUG] унарный минус", exprValue, exprType);
+    }
+}
+
+Tree* Parser::resolveSite(const DesignatorSite& site) {
+    if (site.frameSlot == Node::NoSlot) {
+        return site.root;
+    }
+    uint32_t index = frameBase + site.frameSlot;
+    return index < frameSlots.size() ? frameSlots[index] : nullptr;
+}
+
+// Ячейка значения designator'а: для переменной/поля - само значение, для
+// вызова метода - блок объекта-получателя. Поля без объекта (анализ тела
+// метода) ячейки не имеют.
+TData* Parser::sitePlace(const DesignatorSite& site, Tree* root) {
+    Node* r = root->getNode();
+    TData* base = nullptr;
+
+    switch (r->objType) {
+        case ObjField:
+            base = thisBlock ? thisBlock + r->slot : nullptr;
+            break;
+        case ObjMethod:
+            base = thisBlock;
+            break;
+        case ObjVar:
+            base = r->hasTypeName() ? objectBlocks[r->data.asInt()].get() : &r->data;
+            break;
+        default:
+            base = &r->data;
+            break;
+    }
+
+    if (!base || !site.member) {
+        return base;
     }
+    return base + site.memberOffset;
 }
 
-Tree* Parser::parseDesignator(bool allowMethodCall,
-                              bool& isMethodCall,
-                              std::string& fullName) {
+Tree* Parser::parseDesignator(bool allowMethodCall, const DesignatorSite*& site, TData*& place) {
     if (currentTokenCode != TId) {
         error("Ожидался идентификатор");
     }
 
-    fullName = currentToken;
+    uint32_t sitePos = scanner->getTokenStartPos();
+
+    // повторное выполнение: поиск и проверки уже сделаны, перематываем за designator
+    auto cached = designatorCache.find(sitePos);
+    if (cached != designatorCache.end()) {
+        Tree* root = resolveSite(cached->second);
+        if (root) {
+            site = &cached->second;
+            place = sitePlace(*site, root);
+            setUK(site->endPos);
+            return site->member ? site->member : root;
+        }
+    }
+
+    DesignatorSite entry;
+    entry.fullName = currentToken;
     std::string name = currentToken;
 
-    if (!checkId(name)) {
+    Tree* root = Tree::getCurrent()->FindUp(name);
+    Tree* node = root;
+    if (!node) {
+        (void)checkId(name);
         throw std::runtime_error(
             "Семантическая ошибка: использование необъявленного идентификатора");
     }
 
-    Tree* node = Tree::getCurrent()->FindUp(name);
-    if (!node) {
-        throw std::runtime_error(
-            "Семантическая ошибка: внутренний поиск идентификатора провалился");
+    if (root->getNode()->objType == ObjVar && root->getNode()->slot != Node::NoSlot) {
+        entry.frameSlot = root->getNode()->slot;
+    } else {
+        entry.root = root;
     }
 
     nextToken();
@@ -1296,8 +2743,8 @@ Tree* Parser::parseDesignator(bool allowMethodCall,
     while (currentTokenCode == TPoint) {
         nextToken();
         std::string member = expectId("Ожидался идентификатор после '.'");
-        fullName += ".";
-        fullName += member;
+        entry.fullName += ".";
+        entry.fullName += member;
 
         Node* curNode = node->getNode();
         if (!curNode) {
@@ -1306,8 +2753,8 @@ Tree* Parser::parseDesignator(bool allowMethodCall,
 
         Tree* classNode = nullptr;
         if ((curNode->objType == ObjVar || curNode->objType == ObjField) &&
-            !curNode->typeName.empty()) {
-            classNode = Tree::FindGlobal(curNode->typeName);
+            curNode->hasTypeName()) {
+            classNode = Tree::FindGlobal(curNode->typeName());
         } else {
             std::cerr
                 << "Семантическая ошибка: доступ к члену у не объектного типа"
@@ -1318,7 +2765,7 @@ Tree* Parser::parseDesignator(bool allowMethodCall,
         if (!classNode || !classNode->getNode() ||
             classNode->getNode()->objType != ObjClass) {
             std::cerr << "Семантическая ошибка: тип '"
-                      << (curNode->typeName.empty() ? curNode->id : curNode->typeName)
+                      << (curNode->hasTypeName() ? curNode->typeName() : curNode->id())
                       << "' не найден как класс" << std::endl;
             throw std::runtime_error("Семантическая ошибка");
         }
@@ -1331,10 +2778,12 @@ Tree* Parser::parseDesignator(bool allowMethodCall,
         }
 
         node = memberNode;
+        entry.member = memberNode;
+        if (memberNode->getNode()->objType == ObjField) {
+            entry.memberOffset += memberNode->getNode()->slot;
+        }
     }
 
-    isMethodCall = false;
-
     if (currentTokenCode == TLB) {
         if (!allowMethodCall) {
             error("Вызов метода в недопустимом контексте");
@@ -1350,50 +2799,82 @@ Tree* Parser::parseDesignator(bool allowMethodCall,
 
         expect(TLB, "Ожидалась '(' при вызове метода");
         expect(TRB, "Ожидалась ')' при вызове метода");
-        isMethodCall = true;
+        entry.isMethodCall = true;
+    }
+
+    entry.isLValue = checkLValue(node);
+    entry.type = node->getNode()->datType;
+
+    Node* decl = node->getNode();
+    if (decl->objType == ObjField || (decl->objType == ObjVar && entry.frameSlot == Node::NoSlot)) {
+        auto version = versionSlots.find(decl);
+        if (version == versionSlots.end()) {
+            version = versionSlots.emplace(decl, static_cast<uint32_t>(fieldVersions.size())).first;
+            fieldVersions.push_back(0);
+        }
+        entry.version = version->second;
     }
+    entry.nameId = NameTable::Intern(entry.fullName);
+    entry.endPos = scanner->getTokenStartPos();
 
+    site = &(designatorCache[sitePos] = std::move(entry));
+    place = sitePlace(*site, root);
     return node;
 }
 
 void Parser::BaseExp() {
     if (currentTokenCode == TId) {
-        bool isMethodCall = false;
-        std::string fullName;
-        Tree* node = parseDesignator(true, isMethodCall, fullName);
+        const DesignatorSite* site = nullptr;
+        TData* place = nullptr;
+        Tree* node = parseDesignator(true, site, place);
 
         if (!node || !node->getNode()) {
             throw std::runtime_error("Семантическая ошибка");
         }
 
-        if (isMethodCall) {
-            exprType = node->getNode()->datType;
+        exprType = site->type;
+        exprNode = newExprNode(site->isMethodCall ? ExprCall : ExprVar, exprType);
+        exprNode->site = site;
+        if (!site->isMethodCall) {
+            noteRead(site);
+        }
+
+        // глобальная константа не меняется после объявления: подставляем её значение
+        if (options.optimize && !site->member && site->root &&
+            site->root->getNode()->objType == ObjConst) {
+            exprNode->kind = ExprConst;
+            exprNode->value = site->root->getNode()->data;
+        }
+        if (site->isMethodCall) {
+            noteCall(site);
+
+            auto inlined = inlineBodies.find(node);
+            if (inlined != inlineBodies.end()) {
+                exprNode->kind = ExprInline;
+                exprNode->left = inlined->second.root;
+                exprNode->op = inlined->second.tempCount;
+            }
+
             if (flagInterpret) {
-                TData ret = execMethod(node, fullName);
+                ExprNode* callNode = exprNode;
+                TData ret = execMethod(node, site->fullName, place);
                 exprValue = ret;
-                if (exprType == IntType) exprValue.dataType = TYPE_INT;
-                else if (exprType == DoubleType) exprValue.dataType = TYPE_DOUBLE;
+                exprType = site->type;
+                exprNode = callNode;
             } else {
-                exprValue.dataType = TYPE_UNKNOWN;
+                exprValue.retag(TYPE_UNKNOWN);
             }
             return;
         }
 
-        exprType = node->getNode()->datType;
         if (flagInterpret) {
-            if (node->getNode()->data.dataType == TYPE_INT) {
-                exprValue.dataType = TYPE_INT;
-                exprValue.dataValue.dataAsInt =
-                    node->getNode()->data.dataValue.dataAsInt;
-            } else if (node->getNode()->data.dataType == TYPE_DOUBLE) {
-                exprValue.dataType = TYPE_DOUBLE;
-                exprValue.dataValue.dataAsDouble =
-                    node->getNode()->data.dataValue.dataAsDouble;
+            if (place->isUnknown()) {
+                exprValue.retag(TYPE_UNKNOWN);
             } else {
-                exprValue.dataType = TYPE_UNKNOWN;
+                exprValue = *place;
             }
         } else {
-            exprValue.dataType = TYPE_UNKNOWN;
+            exprValue.retag(TYPE_UNKNOWN);
         }
 
         // postfix ++/-- в выражениях
@@ -1401,53 +2882,45 @@ void Parser::BaseExp() {
             uint16_t op = currentTokenCode;
             nextToken();
 
-            if (!checkLValue(node)) {
+            if (!site->isLValue) {
                 std::cerr << "Семантическая ошибка: '++/--' применимы только к переменным/полям" << std::endl;
                 throw std::runtime_error("Семантическая ошибка");
             }
+            noteWrite(site);
             if (!(exprType == IntType || exprType == DoubleType)) {
                 std::cerr << "Семантическая ошибка: '++/--' применимы только к числовым типам" << std::endl;
                 throw std::runtime_error("Семантическая ошибка");
             }
 
             if (flagInterpret) {
-                if (exprType == IntType) {
-                    int oldv = (exprValue.dataType == TYPE_INT) ? exprValue.dataValue.dataAsInt : 0;
-                    int newv = oldv + ((op == TInc) ? 1 : -1);
-                    TData tmp; tmp.dataType = TYPE_INT; tmp.dataValue.dataAsInt = newv;
-                    assignValue(node->getNode(), IntType, tmp);
-                    exprValue.dataType = TYPE_INT;
-                    exprValue.dataValue.dataAsInt = oldv;
-                } else {
-                    double oldv = (exprValue.dataType == TYPE_DOUBLE) ? exprValue.dataValue.dataAsDouble
-                                  : (exprValue.dataType == TYPE_INT ? static_cast<double>(exprValue.dataValue.dataAsInt) : 0.0);
-                    double newv = oldv + ((op == TInc) ? 1.0 : -1.0);
-                    TData tmp; tmp.dataType = TYPE_DOUBLE; tmp.dataValue.dataAsDouble = newv;
-                    assignValue(node->getNode(), DoubleType, tmp);
-                    exprValue.dataType = TYPE_DOUBLE;
-                    exprValue.dataValue.dataAsDouble = oldv;
-                }
+                touch(site);
+                exprValue = stepPlace(node->getNode(), *place, exprType, op, true);
             }
+
+            exprNode->kind = ExprPostInc;
+            exprNode->op = op;
         }
 
         return;
     } else if (currentTokenCode == TConstInt) {
         exprType = IntType;
+        exprNode = newExprNode(ExprConst, IntType);
+        exprNode->value = makeData<int>(std::stoi(currentToken));
         if (flagInterpret) {
-            exprValue.dataType = TYPE_INT;
-            exprValue.dataValue.dataAsInt = std::stoi(currentToken);
+            exprValue = exprNode->value;
         } else {
-            exprValue.dataType = TYPE_UNKNOWN;
+            exprValue.retag(TYPE_UNKNOWN);
         }
         nextToken();
         return;
     } else if (currentTokenCode == TConstDouble) {
         exprType = DoubleType;
+        exprNode = newExprNode(ExprConst, DoubleType);
+        exprNode->value = makeData<double>(std::stod(currentToken));
         if (flagInterpret) {
-            exprValue.dataType = TYPE_DOUBLE;
-            exprValue.dataValue.dataAsDouble = std::stod(currentToken);
+            exprValue = exprNode->value;
         } else {
-            exprValue.dataType = TYPE_UNKNOWN;
+            exprValue.retag(TYPE_UNKNOWN);
         }
         nextToken();
         return;
@@ -46,113 +46,19 @@ std::string Scanner::getCurrentLineText() const {
 }
 
 uint16_t Scanner::scan(std::string& token) {
-    token.clear();
+    const Lexeme lx = scanLexeme(programText, pos, currentLine);
+    tokenStartPos = lx.start;
 
-    while (programText[pos] == ' ' || programText[pos] == '\t' || programText[pos] == '\n') {
-        if (programText[pos] == '\n') currentLine++;
-        pos++;
-    }
-
-    tokenStartPos = pos;
-
-    if (programText[pos] == '\0') {
+    if (lx.code == TEnd) {
         token = "End of module";
         return TEnd;
     }
 
-    // numbers
-    if (isDigit(programText[pos])) {
-        while (isDigit(programText[pos])) token += programText[pos++];
-
-        if (programText[pos] != '.') return TConstInt;
-
-        token += programText[pos++]; // '.'
-        if (!isDigit(programText[pos])) {
-            printError("некорректная константа", token);
-            return Terr;
-        }
-        while (isDigit(programText[pos])) token += programText[pos++];
-        return TConstDouble;
-    }
-
-    // identifiers / keywords
-    if (isLetter(programText[pos])) {
-        while (isLetter(programText[pos]) || isDigit(programText[pos])) token += programText[pos++];
-        if (isKeyword(token)) return keywords.at(token);
-        return TId;
-    }
-
-    // punctuation/operators
-    auto ch = programText[pos];
-
-    if (ch == '.') { token += programText[pos++]; return TPoint; }
-    if (ch == ',') { token += programText[pos++]; return TComma; }
-    if (ch == ';') { token += programText[pos++]; return TSemicolon; }
-    if (ch == '(') { token += programText[pos++]; return TLB; }
-    if (ch == ')') { token += programText[pos++]; return TRB; }
-    if (ch == '{') { token += programText[pos++]; return TLFB; }
-    if (ch == '}') { token += programText[pos++]; return TRFB; }
-
-    if (ch == '=') {
-        token += programText[pos++];
-        if (programText[pos] == '=') { token += programText[pos++]; return TEq; }
-        return TEval;
-    }
-
-    if (ch == '+') {
-        token += programText[pos++];
-        if (programText[pos] == '=') { token += programText[pos++]; return TPlusEq; }
-        if (programText[pos] == '+') { token += programText[pos++]; return TInc; }
-        return TPlus;
-    }
-
-    if (ch == '-') {
-        token += programText[pos++];
-        if (programText[pos] == '=') { token += programText[pos++]; return TMinusEq; }
-        if (programText[pos] == '-') { token += programText[pos++]; return TDec; }
-        return TMinus;
-    }
-
-    if (ch == '/') {
-        token += programText[pos++];
-        if (programText[pos] == '=') { token += programText[pos++]; return TDivEq; }
-        return TDiv;
+    token.assign(programText, lx.start, lx.length);
+    if (lx.error) {
+        printError(lx.error, token);
     }
-
-    if (ch == '*') {
-        token += programText[pos++];
-        if (programText[pos] == '=') { token += programText[pos++]; return TMultEq; }
-        return TMult;
-    }
-
-    if (ch == '%') {
-        token += programText[pos++];
-        if (programText[pos] == '=') { token += programText[pos++]; return TModEq; }
-        return TMod;
-    }
-
-    if (ch == '>') {
-        token += programText[pos++];
-        if (programText[pos] == '=') { token += programText[pos++]; return TGE; }
-        return TG;
-    }
-
-    if (ch == '<') {
-        token += programText[pos++];
-        if (programText[pos] == '=') { token += programText[pos++]; return TLE; }
-        return TL;
-    }
-
-    if (ch == '!') {
-        token += programText[pos++];
-        if (programText[pos] == '=') { token += programText[pos++]; return TNotEq; }
-        printError("ожидался символ '='", token);
-        return Terr;
-    }
-
-    token += programText[pos++];
-    printError("недопустимый символ", token);
-    return Terr;
+    return lx.code;
 }
 
 void Scanner::getTextFromFile(const std::string& filename) {
@@ -172,18 +78,6 @@ void Scanner::getTextFromFile(const std::string& filename) {
     programText += '\0';
 }
 
-bool Scanner::isDigit(const char& ch) {
-    return ch >= '0' && ch <= '9';
-}
-
-bool Scanner::isLetter(const char& ch) {
-    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
-}
-
-bool Scanner::isKeyword(const std::string& token) {
-    return keywords.find(token) != keywords.end();
-}
-
 void Scanner::printError(const std::string& error, const std::string& token) {
     std::cerr << "\nОшибка: " << error;
     if (!token.empty()) std::cerr << " '" << token << "'";
@@ -0,0 +1,66 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threads) {
+    for (unsigned part = 1; part < std::max(threads, 1u); ++part) {
+        workers.emplace_back(&ThreadPool::workLoop, this, part);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start.notify_all();
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+void ThreadPool::parallelFor(uint32_t total, const Task& fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        count = total;
+        chunk = (total + size() - 1) / size();
+        pending = static_cast<unsigned>(workers.size());
+        ++generation;
+    }
+    start.notify_all();
+
+    runPart(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+    task = nullptr;
+}
+
+void ThreadPool::runPart(unsigned part) const {
+    const uint64_t begin = static_cast<uint64_t>(part) * chunk;
+    if (begin < count) {
+        (*task)(static_cast<uint32_t>(begin), static_cast<uint32_t>(std::min<uint64_t>(count, begin + chunk)));
+    }
+}
+
+void ThreadPool::workLoop(unsigned part) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+
+        runPart(part);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) {
+            done.notify_one();
+        }
+    }
+}
@@ -1,21 +1,53 @@
 #include "Tree.hpp"
 
+std::vector<std::string> NameTable::names{""};
+std::unordered_map<std::string, uint32_t> NameTable::ids{{"", 0}};
+
+uint32_t NameTable::Intern(const std::string& name) {
+    auto it = ids.find(name);
+    if (it != ids.end()) return it->second;
+    uint32_t nameId = static_cast<uint32_t>(names.size());
+    names.push_back(name);
+    ids.emplace(name, nameId);
+    return nameId;
+}
+
+uint32_t NameTable::Find(const std::string& name) {
+    auto it = ids.find(name);
+    return it != ids.end() ? it->second : NoName;
+}
+
+std::vector<std::unique_ptr<Tree[]>> Tree::chunks;
+uint32_t Tree::count = 0;
+
+std::vector<Tree::ChildList> Tree::childLists;
+
 Tree* Tree::root = nullptr;
 Tree* Tree::current = nullptr;
 
-Tree::Tree(Node* data, Tree* parent)
-    : node(data ? std::unique_ptr<Node>(new Node(*data)) : nullptr),
-      parent(parent),
-      firstChild(nullptr),
-      nextSibling(nullptr) {}
+Tree::Tree()
+    : node(),
+      self(NoIndex),
+      parent(NoIndex),
+      children(NoIndex) {}
 
-Tree::~Tree() {
-    delete firstChild;
-    delete nextSibling;
+Tree* Tree::Alloc(const Node& data, Tree* parent) {
+    if ((count & (ChunkSize - 1)) == 0) {
+        chunks.emplace_back(new Tree[ChunkSize]);
+    }
+    Tree* t = At(count);
+    t->node = data;
+    t->self = count;
+    t->parent = parent ? parent->self : NoIndex;
+    t->children = NoIndex;
+    count++;
+    return t;
 }
 
 void Tree::Reset() {
-    delete root;
+    chunks.clear();
+    childLists.clear();
+    count = 0;
     root = nullptr;
     current = nullptr;
 }
@@ -25,7 +57,7 @@ Tree* Tree::getCurrent() { return current; }
 
 Tree* Tree::SetRight(const Node& data) {
     if (!root) {
-        Tree* n = new Tree(new Node(data), nullptr);
+        Tree* n = Alloc(data, nullptr);
         root = n;
         current = n;
         return n;
@@ -33,17 +65,18 @@ Tree* Tree::SetRight(const Node& data) {
 
     if (!current) current = root;
 
-    if (!current->firstChild) {
-        Tree* child = new Tree(new Node(data), current);
-        current->firstChild = child;
-        return child;
+    if (current->children == NoIndex) {
+        current->children = static_cast<uint32_t>(childLists.size());
+        childLists.emplace_back();
     }
 
-    Tree* it = current->firstChild;
-    while (it->nextSibling) it = it->nextSibling;
-
-    Tree* child = new Tree(new Node(data), current);
-    it->nextSibling = child;
+    Tree* child = Alloc(data, current);
+    ChildList& list = childLists[current->children];
+    if (data.objType == ObjEmpty) {
+        list.scopes.push_back({static_cast<uint32_t>(list.decls.size()), child->self});
+    } else {
+        list.decls.push_back({data.nameId, child->self});
+    }
     return child;
 }
 
@@ -53,104 +86,100 @@ Tree* Tree::SetLeft(const Node& data) {
     return n;
 }
 
-Tree* Tree::FindUp(const std::string& id) {
-    Tree* scope = this;
-    while (scope) {
-        Tree* child = scope->firstChild;
-        while (child) {
-            if (child->node && child->node->id == id) return child;
-            child = child->nextSibling;
-        }
-        scope = scope->parent;
+const Tree::ChildRef* Tree::findChild(uint32_t nameId) const {
+    if (children == NoIndex) return nullptr;
+    for (const ChildRef& ref : childLists[children].decls) {
+        if (ref.nameId == nameId) return &ref;
     }
     return nullptr;
 }
 
-Tree* Tree::FindUpOneLevel(const std::string& id) {
+Tree* Tree::FindUp(const std::string& id) {
+    uint32_t nameId = NameTable::Find(id);
+    if (nameId == NameTable::NoName) return nullptr;
+
     Tree* scope = this;
-    Tree* child = scope->firstChild;
-    while (child) {
-        if (child->node && child->node->id == id) return child;
-        child = child->nextSibling;
+    while (scope) {
+        const ChildRef* ref = scope->findChild(nameId);
+        if (ref) return At(ref->index);
+        scope = scope->getParent();
     }
     return nullptr;
 }
 
-Tree* Tree::FindDownLeft(const std::string& id) {
-    Tree* child = firstChild;
-    while (child) {
-        if (child->node && child->node->id == id) return child;
-        child = child->nextSibling;
-    }
-    return nullptr;
+Tree* Tree::FindUpOneLevel(const std::string& id) {
+    return FindDownLeft(id);
 }
 
-static Tree* findClassRecursive(Tree* node, const std::string& id) {
-    if (!node) return nullptr;
-    if (node->getNode() &&
-        node->getNode()->id == id &&
-        node->getNode()->objType == ObjClass) return node;
+Tree* Tree::FindDownLeft(const std::string& id) {
+    uint32_t nameId = NameTable::Find(id);
+    if (nameId == NameTable::NoName) return nullptr;
 
-    Tree* res = findClassRecursive(node->getLeft(), id);
-    if (res) return res;
-    return findClassRecursive(node->getRight(), id);
+    const ChildRef* ref = findChild(nameId);
+    return ref ? At(ref->index) : nullptr;
 }
 
+// классы объявляются только на глобальном уровне
 Tree* Tree::FindGlobal(const std::string& id) {
-    if (!root) return nullptr;
-    return findClassRecursive(root, id);
+    if (!root || root->children == NoIndex) return nullptr;
+    uint32_t nameId = NameTable::Find(id);
+    if (nameId == NameTable::NoName) return nullptr;
+
+    for (const ChildRef& ref : childLists[root->children].decls) {
+        if (ref.nameId == nameId && At(ref.index)->node.objType == ObjClass) return At(ref.index);
+    }
+    return nullptr;
 }
 
 void Tree::printRec(Tree* t, int indent) {
     if (!t) return;
 
-    std::string pad(indent, ' ');
-
     // скрываем узлы Scope и печатаем их детей на том же уровне
-    if (t->node && t->node->id == "[Scope]") {
-        Tree* it = t->firstChild;
-        while (it) {
-            printRec(it, indent);
-            it = it->nextSibling;
-        }
-        return;
-    }
+    bool hidden = (t->node.objType == ObjEmpty && t != root);
+
+    if (!hidden) {
+        std::string pad(indent, ' ');
 
-    if (t->node) {
-        std::cout << pad << t->node->id << " ";
+        std::cout << pad << t->node.id() << " ";
 
-        if (t->node->datType != UndefinedType)
-            std::cout << "(" << TypeName(t->node->datType) << ")";
-        else if (!t->node->typeName.empty())
-            std::cout << "(" << t->node->typeName << ")";
+        if (t->node.datType != UndefinedType)
+            std::cout << "(" << TypeName(t->node.datType) << ")";
+        else if (t->node.hasTypeName())
+            std::cout << "(" << t->node.typeName() << ")";
         else
             std::cout << "(undefined)";
 
-        if (t->node->objType != ObjEmpty)
-            std::cout << " [" << ObjName(t->node->objType) << "]";
+        if (t->node.objType != ObjEmpty)
+            std::cout << " [" << ObjName(t->node.objType) << "]";
 
-        if (t->node->isInitialized)
+        if (t->node.isInitialized)
             std::cout << " {inited}";
 
-        if ((t->node->objType == ObjVar || t->node->objType == ObjConst) &&
-            t->node->data.dataType != TYPE_UNKNOWN) {
+        if ((t->node.objType == ObjVar || t->node.objType == ObjConst) &&
+            !t->node.data.isUnknown()) {
             std::cout << " = ";
-            switch (t->node->data.dataType) {
-                case TYPE_INT: std::cout << t->node->data.dataValue.dataAsInt; break;
-                case TYPE_DOUBLE: std::cout << t->node->data.dataValue.dataAsDouble; break;
+            switch (t->node.data.type()) {
+                case TYPE_INT: std::cout << t->node.data.asInt(); break;
+                case TYPE_DOUBLE: std::cout << t->node.data.asDouble(); break;
                 default: break;
             }
         }
 
         std::cout << "\n";
+        indent += 4;
     }
 
-    if (t->firstChild) {
-        Tree* it = t->firstChild;
-        while (it) {
-            printRec(it, indent + 4);
-            it = it->nextSibling;
+    if (t->children == NoIndex) return;
+
+    // объявления и вложенные области в порядке добавления
+    const ChildList& list = childLists[t->children];
+    size_t s = 0;
+    for (size_t d = 0; d <= list.decls.size(); ++d) {
+        while (s < list.scopes.size() && list.scopes[s].declCount == d) {
+            printRec(At(list.scopes[s].index), indent);
+            s++;
         }
+        if (d < list.decls.size()) printRec(At(list.decls[d].index), indent);
     }
 }
 
@@ -186,13 +215,13 @@ std::string Tree::ObjName(TypeObject o) {
 }
 
 void Tree::semIn() {
-    Node n("[Scope]", ObjEmpty, UndefinedType, false, "");
+    static const Node n("[Scope]", ObjEmpty, UndefinedType, false, "");
     SetLeft(n);
 }
 
 void Tree::semOut() {
     if (!current) return;
-    if (current->parent) current = current->parent;
+    if (current->parent != NoIndex) current = At(current->parent);
 }
 
 bool checkId(const std::string& id) {
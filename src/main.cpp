@@ -1,24 +1,240 @@
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
 #include "Scanner.hpp"
 #include "Parser.hpp"
+#include "CodeGen.hpp"
+#include "ConstEval.hpp"
+#include "Output.hpp"
 
-int main()
+static void run(const std::string& path, const ParserOptions& options)
 {
+    Tree::Reset();
+
+    Scanner* scanner = new Scanner(path);
+    Parser* parser = new Parser(scanner, options);
+
+    parser->parse();
+
+    delete parser;
+    delete scanner;
+}
+
+// вывод программы без отладочных строк: трассировка зависит от оптимизаций
+static std::string withoutDebug(const std::string& text)
+{
+    std::istringstream in(text);
+    std::string line, result;
+    while (std::getline(in, line))
+    {
+        if (line.rfind("[DEBUG]", 0) != 0)
+        {
+            result += line;
+            result += '\n';
+        }
+    }
+    return result;
+}
+
+// Выполняет программу без оптимизаций и с ними, сравнивает вывод.
+static int verify(const std::string& path, ParserOptions options)
+{
+    std::streambuf* out = std::cout.rdbuf();
+    std::streambuf* err = std::cerr.rdbuf();
+
+    std::ostringstream plain, optimized;
+
+    options.optimize = false;
+    std::cout.rdbuf(plain.rdbuf());
+    std::cerr.rdbuf(plain.rdbuf());
+    run(path, options);
+
+    options.optimize = true;
+    std::cout.rdbuf(optimized.rdbuf());
+    std::cerr.rdbuf(optimized.rdbuf());
+    run(path, options);
+
+    std::cout.rdbuf(out);
+    std::cerr.rdbuf(err);
+
+    std::cout << optimized.str();
+
+    if (withoutDebug(plain.str()) != withoutDebug(optimized.str()))
+    {
+        std::cerr << "Проверка оптимизации: вывод отличается от выполнения без оптимизаций" << std::endl;
+        return 2;
+    }
+    std::cerr << "Проверка оптимизации: вывод совпадает" << std::endl;
+    return 0;
+}
+
+// Транслирует программу в исходник C++ или ассемблера; если задан exePath,
+// собирает его. C++ - компилятором из $CXX (по умолчанию c++), -frounding-math
+// запрещает компилятору переставлять знак в double-выражениях: иначе меняется
+// знак NaN. Ассемблер - через $AS и $LD (по умолчанию as и ld).
+static int translate(const std::string& path, const ParserOptions& options,
+                     const std::string& srcPath, const std::string& exePath, bool assembly)
+{
+    Tree::Reset();
+
+    Scanner scanner(path);
+    Parser parser(&scanner, options);
+    parser.analyse();
+    AstProgram program = buildAst(scanner, parser);
+    program.quiet = options.quiet;
+    if (options.optimize)
+        eliminateDeadCode(program);
+
+    std::ofstream out(srcPath);
+    if (!out)
+        throw std::runtime_error("не удалось открыть '" + srcPath + "'");
+    if (assembly)
+        emitAsm(program, out);
+    else
+        emitCpp(program, out);
+    out.close();
+
+    if (exePath.empty())
+        return 0;
+
+    auto tool = [](const char* name, const char* fallback) {
+        const char* value = std::getenv(name);
+        return std::string(value && *value ? value : fallback);
+    };
+    std::string command;
+    if (assembly)
+        command = tool("AS", "as") + " -o \"" + exePath + ".o\" \"" + srcPath + "\" && " +
+                  tool("LD", "ld") + " -o \"" + exePath + "\" \"" + exePath + ".o\"";
+    else
+        command = tool("CXX", "c++") + " -O2 -std=c++17 -frounding-math -o \"" + exePath + "\" \"" + srcPath + "\"";
+    if (std::system(command.c_str()) != 0)
+    {
+        std::cerr << "Ошибка: сборка '" << exePath << "' не удалась" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Итоговые значения, которые evaluateProgram даст при компиляции C++:
+// то же вычисление, выполненное во время работы.
+static int finalValues(const std::string& path)
+{
+    std::ifstream input(path);
+    if (!input)
+        throw std::runtime_error("не удалось открыть '" + path + "'");
+    std::stringstream text;
+    text << input.rdbuf();
+    const std::string source = text.str();
+
+    const ConstValues values = evaluateProgram(source);
+    for (size_t i = 0; i < values.count; ++i)
+    {
+        const ConstValue& v = values.values[i];
+        std::cout << v.name << " = ";
+        if (v.value.isDouble())
+            std::cout << v.value.asDouble() << std::endl;
+        else
+            std::cout << v.value.asInt() << std::endl;
+    }
+    return 0;
+}
+
+static int usage(const char* program)
+{
+    std::cerr << "Использование: " << program
+              << " файл [--no-opt] [--verify-opt] [--inline-limit=N] [--unroll=N] [--threads=N] [--jit=N]\n"
+                 "    [--emit-cpp=файл.cpp] [--emit-asm=файл.s] [--build=файл] [--quiet] [--final-values]\n"
+                 "    [--event-log=файл.log]\n"
+                 "--quiet - только с --emit-cpp, --emit-asm или --build: программа не печатает присваивания"
+              << std::endl;
+    return 1;
+}
+
+// cppTranslator файл [--no-opt] [--verify-opt] [--inline-limit=N] [--unroll=N] [--threads=N] [--jit=N]
+//               [--emit-cpp=файл.cpp] [--emit-asm=файл.s] [--build=файл] [--quiet] [--final-values]
+//               [--event-log=файл.log]
+// --quiet относится к генераторам кода, без них - ошибка использования
+int main(int argc, char** argv)
+{
+    std::string path;
+    ParserOptions options;
+    bool verifyMode = false;
+    bool valuesMode = false;
+    std::string cppPath, asmPath, exePath;
+
     try
     {
-        Scanner* scanner = new Scanner("C:\\vs code\\c++\\trans\\test.cpp");
-        Parser* parser = new Parser(scanner);
-        
-        parser->parse();
-        
-        delete parser;
-        delete scanner;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--no-opt")
+                options.optimize = false;
+            else if (arg == "--verify-opt")
+                verifyMode = true;
+            else if (arg.rfind("--event-log=", 0) == 0)
+                options.eventLog = arg.substr(12);
+            else if (arg == "--quiet")
+                options.quiet = true;
+            else if (arg == "--final-values")
+                valuesMode = true;
+            else if (arg.rfind("--inline-limit=", 0) == 0)
+                options.inlineLimit = static_cast<uint32_t>(std::stoul(arg.substr(15)));
+            else if (arg.rfind("--unroll=", 0) == 0)
+                options.unroll = static_cast<uint32_t>(std::stoul(arg.substr(9)));
+            else if (arg.rfind("--threads=", 0) == 0)
+                options.threads = static_cast<uint32_t>(std::stoul(arg.substr(10)));
+            else if (arg.rfind("--jit=", 0) == 0)
+                options.jit = static_cast<uint32_t>(std::stoul(arg.substr(6)));
+            else if (arg.rfind("--emit-cpp=", 0) == 0)
+                cppPath = arg.substr(11);
+            else if (arg.rfind("--emit-asm=", 0) == 0)
+                asmPath = arg.substr(11);
+            else if (arg.rfind("--build=", 0) == 0)
+                exePath = arg.substr(8);
+            else
+                path = arg;
+        }
+        const bool generating = !cppPath.empty() || !asmPath.empty() || !exePath.empty();
+        if (path.empty() || (options.quiet && (!generating || verifyMode || valuesMode)))
+            return usage(argv[0]);
+
+        if (verifyMode)
+            return verify(path, options);
+        if (valuesMode)
+            return finalValues(path);
+
+        if (!asmPath.empty())
+            return translate(path, options, asmPath, exePath, true);
+        if (!cppPath.empty() || !exePath.empty())
+            return translate(path, options, cppPath.empty() ? exePath + ".cpp" : cppPath, exePath, false);
+
+        // вывод интерпретатора - через фоновый поток, сбрасывается при выходе и при падении
+        AsyncOutput output(STDOUT_FILENO);
+        std::streambuf* console = std::cout.rdbuf(&output);
+        std::ostream* errTie = std::cerr.tie(&output.tie());
+        output.flushOnCrash();
+        try
+        {
+            run(path, options);
+        }
+        catch (...)
+        {
+            std::cerr.tie(errTie);
+            std::cout.rdbuf(console);
+            throw;
+        }
+        std::cerr.tie(errTie);
+        std::cout.rdbuf(console);
     }
     catch (const std::exception& e)
     {
         std::cerr << "Ошибка: " << e.what() << std::endl;
         return 1;
     }
-    
+
     return 0;
 }
@@ -0,0 +1,120 @@
+// Сверка evaluateProgram с интерпретатором: ожидаемые значения - последние
+// строки "имя = значение", которые печатает cppTranslator на тех же
+// программах. Файл только компилируется; расхождение - ошибка сборки.
+// double сравниваются с точностью печати (%g, 6 знаков).
+
+#include "ConstEval.hpp"
+
+namespace {
+
+constexpr bool printedAs(double value, double printed) {
+    const double diff = value > printed ? value - printed : printed - value;
+    const double scale = printed < 0 ? -printed : printed;
+    return diff <= scale * 5e-6;
+}
+
+// классы, вложенные объекты, методы с записью полей, глобальные
+constexpr ConstValues objects = evaluateProgram(R"(
+class Point {
+    int x, y;
+    double w;
+    int sum() { return x + y; }
+    double scaled() { return w * 2.5; }
+    int bump() { x = x + 1; return x; }
+};
+class Box {
+    Point a;
+    Point b;
+    int area() { return (b.x - a.x) * (b.y - a.y); }
+};
+int G;
+double H;
+int main() {
+    Point p;
+    Box bx;
+    p.x = 3;
+    p.y = 4;
+    p.w = 1.5;
+    bx.a.x = 1;
+    bx.a.y = 2;
+    bx.b.x = 5;
+    bx.b.y = 9;
+    int s = p.sum() + bx.area();
+    double sc = p.scaled();
+    int i = 0;
+    while (i < 10) { G += p.bump(); i++; }
+    H = G / 4.0;
+}
+)");
+static_assert(objects.getInt("s") == 35);
+static_assert(objects.getDouble("sc") == 3.75);
+static_assert(objects.getInt("i") == 10);
+static_assert(objects.getInt("G") == 85);
+static_assert(objects.getDouble("H") == 21.25);
+
+// приведения при присваивании и результата метода, составное
+// присваивание с вызовом справа, переполнение int
+constexpr ConstValues conversions = evaluateProgram(R"(
+class O {
+    int a;
+    int m0() { return 65536 - 65.60; }
+    double m1() { return a * 3; }
+    int get() { int t = a; return t; }
+};
+int main() {
+    O o;
+    o.a = 2;
+    int b = o.m0();
+    double c = o.m1() / 5;
+    double d = 10.5;
+    d -= o.get() + 0.5;
+    int m = 100;
+    m %= o.get() + 5;
+    int big = 2147483647;
+    big = big + 1;
+    int q = 7 / 2;
+    double r = 7 / 2.0;
+    int t = 9.99;
+    double u = -3;
+    u *= 1.5;
+}
+)");
+static_assert(conversions.getInt("b") == 65470);
+static_assert(printedAs(conversions.getDouble("c"), 1.2));
+static_assert(conversions.getDouble("d") == 8);
+static_assert(conversions.getInt("m") == 2);
+static_assert(conversions.getInt("big") == -2147483648);
+static_assert(conversions.getInt("q") == 3);
+static_assert(conversions.getDouble("r") == 3.5);
+static_assert(conversions.getInt("t") == 9);
+static_assert(conversions.getDouble("u") == -4.5);
+
+// рекурсия с return внутри while, циклы с локальными в теле
+constexpr ConstValues loops = evaluateProgram(R"(
+class R {
+    int d;
+    int rec() { while (d > 0) { d--; return rec() + 2; } return 0; }
+};
+R r;
+int fib;
+int main() {
+    r.d = 12;
+    int n = r.rec();
+    int a = 0;
+    int b = 1;
+    int k = 0;
+    while (k < 20) { int t = a + b; a = b; b = t; k = k + 1; }
+    fib = a;
+    double acc = 0;
+    int j = 1;
+    while (j <= 50) { acc += 1.0 / j; j++; }
+}
+)");
+static_assert(loops.getInt("n") == 24);
+static_assert(loops.getInt("fib") == 6765);
+static_assert(loops.getInt("b") == 10946);
+static_assert(loops.getInt("k") == 20);
+static_assert(printedAs(loops.getDouble("acc"), 4.49921));
+static_assert(loops.getInt("j") == 51);
+
+}  // namespace
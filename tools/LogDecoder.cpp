@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "EventLog.hpp"
+
+// cppTranslatorLog файл.log [--stats]
+// Восстанавливает по журналу событий (--event-log) текст: присваивания в
+// виде printAssignment, вход и выход из методов, проходы циклов и return.
+// С --stats - только число событий каждого вида, присваиваний по именам и
+// проходов по циклам.
+
+namespace {
+
+struct Log {
+    std::vector<EventRecord> records;
+    std::vector<std::string> names;
+};
+
+Log readLog(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("не удалось открыть '" + path + "'");
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    EventLogHeader header;
+    if (bytes.size() < sizeof header)
+        throw std::runtime_error("файл короче заголовка журнала");
+    std::memcpy(&header, bytes.data(), sizeof header);
+    if (std::memcmp(header.magic, EventLogHeader().magic, sizeof header.magic) != 0 ||
+        header.version != EventLogHeader::Version || header.recordSize != sizeof(EventRecord))
+        throw std::runtime_error("'" + path + "' - не журнал событий этой версии");
+
+    // незакрытый журнал: записи до первой нулевой
+    const bool closed = header.count != 0 || header.namesOffset != 0;
+    const uint64_t space = (bytes.size() - sizeof header) / sizeof(EventRecord);
+    const uint64_t limit = closed ? std::min(header.count, space) : space;
+
+    Log log;
+    log.records.resize(limit);
+    std::memcpy(log.records.data(), bytes.data() + sizeof header, limit * sizeof(EventRecord));
+    if (!closed)
+    {
+        auto end = std::find_if(log.records.begin(), log.records.end(),
+                                [](const EventRecord& r) { return r.kind == EventNone; });
+        log.records.erase(end, log.records.end());
+        std::cerr << "Предупреждение: журнал не закрыт, имена не сохранены" << std::endl;
+        return log;
+    }
+
+    uint64_t at = header.namesOffset;
+    for (uint64_t i = 0; i < header.nameCount; ++i)
+    {
+        uint32_t length = 0;
+        if (at + sizeof length > bytes.size())
+            throw std::runtime_error("таблица имён журнала обрезана");
+        std::memcpy(&length, bytes.data() + at, sizeof length);
+        at += sizeof length;
+        if (at + length > bytes.size())
+            throw std::runtime_error("таблица имён журнала обрезана");
+        log.names.emplace_back(bytes.data() + at, length);
+        at += length;
+    }
+    return log;
+}
+
+std::string name(const Log& log, uint32_t id)
+{
+    return id < log.names.size() ? log.names[id] : "#" + std::to_string(id);
+}
+
+void printValue(const EventRecord& r)
+{
+    if (r.type == EventInt)
+        std::cout << static_cast<int>(static_cast<uint32_t>(r.value));
+    else if (r.type == EventDouble)
+        std::cout << std::bit_cast<double>(r.value);
+}
+
+void printTrace(const Log& log)
+{
+    for (const EventRecord& r : log.records)
+    {
+        switch (r.kind)
+        {
+            case EventAssign:
+                std::cout << name(log, r.id) << " = ";
+                printValue(r);
+                std::cout << '\n';
+                break;
+            case EventEnter:
+                std::cout << "[enter] " << name(log, r.id) << '\n';
+                break;
+            case EventExit:
+                std::cout << "[exit] " << name(log, r.id) << " -> ";
+                printValue(r);
+                std::cout << '\n';
+                break;
+            case EventLoop:
+                std::cout << "[loop] #" << r.id << '\n';
+                break;
+            case EventReturn:
+                std::cout << "[return] ";
+                printValue(r);
+                std::cout << '\n';
+                break;
+            default:
+                std::cout << "[?] kind=" << static_cast<int>(r.kind) << '\n';
+                break;
+        }
+    }
+}
+
+void printStats(const Log& log)
+{
+    static const char* const kinds[] = {"none", "assign", "enter", "exit", "loop", "return"};
+    uint64_t byKind[std::size(kinds)] = {};
+    std::map<uint32_t, uint64_t> assigns, calls, loops;
+    for (const EventRecord& r : log.records)
+    {
+        if (r.kind < std::size(kinds)) byKind[r.kind]++;
+        if (r.kind == EventAssign) assigns[r.id]++;
+        if (r.kind == EventEnter) calls[r.id]++;
+        if (r.kind == EventLoop) loops[r.id]++;
+    }
+
+    std::cout << "событий: " << log.records.size() << '\n';
+    for (size_t k = 1; k < std::size(kinds); ++k)
+        std::cout << "  " << kinds[k] << ": " << byKind[k] << '\n';
+
+    auto top = [&](const char* title, const std::map<uint32_t, uint64_t>& counts, bool named) {
+        std::vector<std::pair<uint64_t, uint32_t>> sorted;
+        for (const auto& [id, n] : counts) sorted.emplace_back(n, id);
+        std::sort(sorted.rbegin(), sorted.rend());
+        std::cout << title << ":\n";
+        for (const auto& [n, id] : sorted)
+            std::cout << "  " << (named ? name(log, id) : "#" + std::to_string(id)) << ": " << n << '\n';
+    };
+    top("присваивания", assigns, true);
+    top("вызовы методов", calls, true);
+    top("проходы циклов", loops, false);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::string path;
+    bool stats = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--stats")
+            stats = true;
+        else
+            path = arg;
+    }
+    if (path.empty())
+    {
+        std::cerr << "использование: cppTranslatorLog файл.log [--stats]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        const Log log = readLog(path);
+        if (stats)
+            printStats(log);
+        else
+            printTrace(log);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Ошибка: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}